@@ -0,0 +1,130 @@
+#!/bin/sh
+#
+# Runs every program of the benchmark corpus through kplc, checks its
+# output against NAME.out and reports its compile time: the fastest of
+# RUNS samples, each one process compiling the program REPEAT times with
+# --repeat. The time is the in-process total of --time-report divided by
+# REPEAT, so process start-up does not drown the compiler. A single
+# compile takes well under 0.1 ms and a fresh process runs it cold, so
+# one compile per sample is mostly timer and scheduler noise. Other load
+# on the machine only ever slows a sample down, so the fastest one is
+# the stable estimate: it stays within a few percent on unchanged code,
+# where the median still moved by 40%. A slowdown of the whole machine,
+# such as a lower clock, is taken out by a fixed awk loop timed in the
+# same rounds: the baseline is scaled by how much slower the loop ran
+# than when the baseline was recorded. A time slower than the scaled
+# baseline by more than THRESHOLD percent (and by at least FLOOR ms) is
+# reported as a regression and makes the script fail.
+#
+# NAME.in holds the READI/READC input of each program; it is fed to
+# every engine on stdin. kplc is the only engine so far.
+#
+# usage: run.sh [-n RUNS] [-r REPEAT] [-t THRESHOLD] [-u] [KPLC]
+#   -u  rewrite baseline.txt with the times of this run
+
+RUNS=15
+REPEAT=500
+THRESHOLD=25
+FLOOR=0.005
+UPDATE=0
+
+BENCH=$(cd "$(dirname "$0")" && pwd)
+BASELINE="$BENCH/baseline.txt"
+
+while getopts "n:r:t:u" opt; do
+  case $opt in
+    n) RUNS=$OPTARG ;;
+    r) REPEAT=$OPTARG ;;
+    t) THRESHOLD=$OPTARG ;;
+    u) UPDATE=1 ;;
+    *) echo "usage: $0 [-n RUNS] [-r REPEAT] [-t THRESHOLD] [-u] [KPLC]" >&2; exit 2 ;;
+  esac
+done
+shift $((OPTIND - 1))
+KPLC=${1:-"$BENCH/../src/kplc"}
+
+if [ ! -x "$KPLC" ]; then
+  echo "$0: no kplc at $KPLC" >&2
+  exit 2
+fi
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# smallest of the numbers on stdin
+fastest() {
+  sort -n | head -1
+}
+
+# milliseconds taken by a fixed amount of CPU work
+calibrate() {
+  start=$(date +%s%N)
+  awk 'BEGIN { for (i = 0; i < 300000; i++) s += i * i % 7 }'
+  end=$(date +%s%N)
+  awk -v s="$start" -v e="$end" 'BEGIN { printf "%.3f\n", (e - s) / 1e6 }'
+}
+
+status=0
+[ $UPDATE -eq 1 ] && : > "$TMP/baseline"
+
+# input file of program $1
+input_of() {
+  if [ -f "$BENCH/$1.in" ]; then echo "$BENCH/$1.in"; else echo /dev/null; fi
+}
+
+for source in "$BENCH"/*.kpl; do
+  name=$(basename "$source" .kpl)
+  : > "$TMP/$name.times"
+  "$KPLC" "$source" < "$(input_of $name)" | cmp -s - "$BENCH/$name.out" ||
+    touch "$TMP/$name.wrong"
+done
+
+# Samples go round the programs, so a burst of load on the machine is
+# spread over all of them instead of covering every sample of one
+i=0
+: > "$TMP/calibration"
+while [ $i -lt $RUNS ]; do
+  calibrate >> "$TMP/calibration"
+  for source in "$BENCH"/*.kpl; do
+    name=$(basename "$source" .kpl)
+    [ -f "$TMP/$name.wrong" ] && continue
+    "$KPLC" --repeat=$REPEAT --time-report --report-format=json "$source" < "$(input_of $name)" 2>&1 >/dev/null |
+      sed -n 's/.*"total_ms": \([0-9.]*\).*/\1/p' |
+      awk -v r=$REPEAT '{ printf "%.4f\n", $1 / r }' >> "$TMP/$name.times"
+  done
+  i=$((i + 1))
+done
+
+calibration=$(fastest < "$TMP/calibration")
+[ $UPDATE -eq 1 ] && echo "calibration awk $calibration" >> "$TMP/baseline"
+scale=$(awk -v c="$calibration" '$1 == "calibration" && $3 > 0 { printf "%.4f\n", c / $3 }' "$BASELINE" 2>/dev/null)
+[ -n "$scale" ] || scale=1
+printf "machine speed: calibration %.3f ms, baseline scaled by %.3f\n" "$calibration" "$scale"
+printf "%-12s %-6s %10s %10s %8s\n" "program" "engine" "time ms" "base ms" "change"
+
+for source in "$BENCH"/*.kpl; do
+  name=$(basename "$source" .kpl)
+  if [ -f "$TMP/$name.wrong" ]; then
+    printf "%-12s %-6s %10s\n" "$name" "kplc" "WRONG OUTPUT"
+    status=1
+    continue
+  fi
+
+  time=$(fastest < "$TMP/$name.times")
+  [ $UPDATE -eq 1 ] && echo "$name kplc $time" >> "$TMP/baseline"
+
+  base=$(awk -v n="$name" -v s="$scale" '$1 == n && $2 == "kplc" { printf "%.4f\n", $3 * s }' "$BASELINE" 2>/dev/null)
+  if [ -z "$base" ]; then
+    printf "%-12s %-6s %10.4f %10s %8s\n" "$name" "kplc" "$time" "-" "-"
+    continue
+  fi
+  verdict=$(awk -v t="$time" -v b="$base" -v p="$THRESHOLD" -v f="$FLOOR" 'BEGIN {
+    change = (b > 0) ? 100 * (t - b) / b : 0
+    flag = (t > b * (1 + p / 100) && t - b >= f) ? " REGRESSION" : ""
+    printf "%+7.1f%%%s", change, flag }')
+  printf "%-12s %-6s %10.4f %10.4f %s\n" "$name" "kplc" "$time" "$base" "$verdict"
+  case $verdict in *REGRESSION*) [ $UPDATE -eq 0 ] && status=1 ;; esac
+done
+
+[ $UPDATE -eq 1 ] && mv "$TMP/baseline" "$BASELINE"
+exit $status
@@ -0,0 +1,163 @@
+#!/bin/sh
+#
+# Checks that the front end scales linearly. For each axis a program is
+# generated at doubling sizes and compiled; the growth exponent of
+# compile time and of peak live heap is the slope of a least-squares fit
+# in log-log space. An exponent above LIMIT fails the run.
+#
+#   width  N variables in one scope, each referenced once
+#   depth  N nested procedures, each using a global and its own local
+#   expr   one expression of N operands joined by + and *
+#   power  one chain of N operands joined by **
+#
+# Time is the in-process total of --time-report minus the output phase:
+# the symbol table dump indents every line by its depth, so its size is
+# quadratic in the nesting depth by format. Memory is peak_live_bytes
+# from --mem-report, which is exact. The expr and power axes keep nothing
+# on the heap, so they measure peak_rss_kib instead, which includes the
+# stack, and run up to a million operands. A compile that crashes fails its
+# axis.
+#
+# usage: scaling.sh [-l LIMIT] [-r RUNS] [-v] [KPLC]
+
+LIMIT=1.1
+RUNS=3
+VERBOSE=0
+
+BENCH=$(cd "$(dirname "$0")" && pwd)
+
+while getopts "l:r:v" opt; do
+  case $opt in
+    l) LIMIT=$OPTARG ;;
+    r) RUNS=$OPTARG ;;
+    v) VERBOSE=1 ;;
+    *) echo "usage: $0 [-l LIMIT] [-r RUNS] [-v] [KPLC]" >&2; exit 2 ;;
+  esac
+done
+shift $((OPTIND - 1))
+KPLC=${1:-"$BENCH/../src/kplc"}
+
+if [ ! -x "$KPLC" ]; then
+  echo "$0: no kplc at $KPLC" >&2
+  exit 2
+fi
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# Input generators, one per axis
+
+gen_width() {
+  awk -v n="$1" 'BEGIN {
+    print "PROGRAM WIDTH;"
+    print "VAR"
+    for (i = 1; i <= n; i++) printf "  V%d : INTEGER;\n", i
+    print "BEGIN"
+    for (i = 1; i <= n; i++) printf "  CALL WRITEI(V%d);\n", i
+    print "  CALL WRITELN"
+    print "END." }'
+}
+
+gen_depth() {
+  awk -v n="$1" 'BEGIN {
+    print "PROGRAM DEPTH;"
+    print "VAR G : INTEGER;"
+    for (i = 1; i <= n; i++) printf "PROCEDURE P%d;\nVAR L%d : INTEGER;\n", i, i
+    for (i = n; i >= 1; i--) printf "BEGIN\n  CALL WRITEI(G);\n  CALL WRITEI(L%d)\nEND;\n", i
+    print "BEGIN"
+    print "  CALL P1"
+    print "END." }'
+}
+
+gen_expr() {
+  awk -v n="$1" 'BEGIN {
+    print "PROGRAM EXPR;"
+    print "VAR X : INTEGER;"
+    print "BEGIN"
+    printf "  CALL WRITEI(X"
+    for (i = 1; i < n; i++) printf (i % 2) ? " + X" : " * X"
+    print ")"
+    print "END." }'
+}
+
+gen_power() {
+  awk -v n="$1" 'BEGIN {
+    print "PROGRAM POWER;"
+    print "VAR X : INTEGER;"
+    print "BEGIN"
+    printf "  X := X"
+    for (i = 1; i < n; i++) printf " ** X"
+    print ""
+    print "END." }'
+}
+
+# Prints "time_ms memory" for one compile: the median time over RUNS and
+# the report field named by $2
+measure() {
+  i=0
+  : > "$TMP/samples"
+  while [ $i -lt $RUNS ]; do
+    "$KPLC" --time-report --mem-report --report-format=json "$1" 2>&1 >/dev/null |
+      awk -v memory="$2" 'function field(name) {
+          # the first occurrence is the total, later ones are per site
+          if (!match($0, "\"" name "\": [0-9.]+")) return 0
+          return substr($0, RSTART + length(name) + 4, RLENGTH - length(name) - 4)
+        }
+        { print field("total_ms") - field("output_ms"), field(memory) }' >> "$TMP/samples"
+    i=$((i + 1))
+  done
+  sort -n "$TMP/samples" | awk '{ t[NR] = $1; m = $2 } END { print t[int((NR + 1) / 2)], m }'
+}
+
+# Least-squares slope of log(y) over log(x) for "x y" lines
+exponent() {
+  awk '$2 > 0 { x = log($1); y = log($2); n++; sx += x; sy += y; sxx += x * x; sxy += x * y }
+    END { d = n * sxx - sx * sx; printf "%.2f\n", (n > 1 && d != 0) ? (n * sxy - sx * sy) / d : 0 }'
+}
+
+# axis, first size, number of doublings, memory field of the report
+check_axis() {
+  axis=$1
+  size=$2
+  step=0
+  : > "$TMP/time"
+  : > "$TMP/memory"
+  steps=$3
+  field=$4
+  while [ $step -lt $steps ]; do
+    gen_$axis $size > "$TMP/$axis.kpl"
+    "$KPLC" "$TMP/$axis.kpl" > /dev/null 2>&1
+    code=$?
+    if [ $code -gt 128 ]; then
+      printf "%-6s kplc killed by signal %d at size %d FAIL\n" "$axis" $((code - 128)) $size
+      status=1
+      return
+    fi
+    result=$(measure "$TMP/$axis.kpl" $field)
+    time=${result% *}
+    memory=${result#* }
+    if [ -z "$time" ] || [ -z "$memory" ] || [ "$time" = "$result" ]; then
+      echo "$0: $KPLC printed no --time-report/--mem-report" >&2
+      exit 2
+    fi
+    [ $VERBOSE -eq 1 ] && printf "  %-6s %8d %10.3f ms %10d %s\n" "$axis" $size $time $memory $field
+    echo "$size $time" >> "$TMP/time"
+    echo "$size $memory" >> "$TMP/memory"
+    size=$((size * 2))
+    step=$((step + 1))
+  done
+
+  for measure in time memory; do
+    e=$(exponent < "$TMP/$measure")
+    verdict=$(awk -v e="$e" -v l="$LIMIT" 'BEGIN { print (e > l) ? "FAIL" : "ok" }')
+    printf "%-6s %-7s exponent %5.2f (limit %s) %s\n" "$axis" "$measure" "$e" "$LIMIT" "$verdict"
+    [ "$verdict" = "FAIL" ] && status=1
+  done
+}
+
+status=0
+check_axis width 1000 5 peak_live_bytes
+check_axis depth 256 5 peak_live_bytes
+check_axis expr 62500 5 peak_rss_kib
+check_axis power 62500 5 peak_rss_kib
+exit $status
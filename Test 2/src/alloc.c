@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include "alloc.h"
+
+// Prefixed to each block while tracking so that FREE knows its size and
+// the call site it is charged to
+typedef union {
+  struct {
+    size_t size;
+    int site;
+  } info;
+  max_align_t align;
+} AllocHeader;
+
+// Must be set before the first ALLOC and never changed afterwards
+int trackAllocations = 0;
+AllocStats allocStats;
+
+// Set by a compile server once its long-lived data is built; from then on
+// ALLOC takes blocks from the arena and FREE leaves them there
+int useArena = 0;
+
+/******************* Call sites ******************************/
+
+AllocSite allocSites[MAX_ALLOC_SITES];
+int allocSiteCount = 0;
+
+// Open addressing over (file, line); __FILE__ is one string per
+// translation unit so the pointer identifies the file.
+int siteTable[MAX_ALLOC_SITES * 2];
+
+int findSite(const char *file, int line) {
+  unsigned h = ((unsigned) (size_t) file * 31u + line) & (MAX_ALLOC_SITES * 2 - 1);
+  int i;
+
+  while ((i = siteTable[h]) != 0) {
+    if (allocSites[i - 1].file == file && allocSites[i - 1].line == line)
+      return i - 1;
+    h = (h + 1) & (MAX_ALLOC_SITES * 2 - 1);
+  }
+  // once the table is full the last site collects everything else
+  if (allocSiteCount == MAX_ALLOC_SITES)
+    return MAX_ALLOC_SITES - 1;
+  allocSites[allocSiteCount].file = file;
+  allocSites[allocSiteCount].line = line;
+  siteTable[h] = ++allocSiteCount;
+  return allocSiteCount - 1;
+}
+
+int compareSiteBytes(const void *a, const void *b) {
+  long long ba = ((const AllocSite *) a)->bytes;
+  long long bb = ((const AllocSite *) b)->bytes;
+  return (ba < bb) - (ba > bb);
+}
+
+/******************* Arena ******************************/
+
+#define ARENA_CHUNK_SIZE (256 * 1024)
+
+// The chunks are kept from one request to the next, so a server reuses
+// memory that is already mapped instead of growing a fresh heap each time.
+// Resetting the arena also reclaims a compile cut short by an error.
+typedef struct ArenaChunk_ {
+  struct ArenaChunk_ *next;
+  size_t size;
+  size_t used;
+  max_align_t data[];
+} ArenaChunk;
+
+ArenaChunk *arenaChunks = NULL;
+ArenaChunk *arenaCurrent = NULL;
+
+void* arenaAllocate(size_t size) {
+  ArenaChunk *chunk = arenaCurrent;
+  void *block;
+
+  size = (size + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t);
+  while (chunk != NULL && chunk->size - chunk->used < size)
+    chunk = chunk->next;
+  if (chunk == NULL) {
+    size_t chunkSize = (size > ARENA_CHUNK_SIZE) ? size : ARENA_CHUNK_SIZE;
+    chunk = (ArenaChunk*) malloc(sizeof(ArenaChunk) + chunkSize);
+    if (chunk == NULL) return NULL;
+    chunk->size = chunkSize;
+    chunk->used = 0;
+    chunk->next = NULL;
+    if (arenaCurrent == NULL)
+      arenaChunks = chunk;
+    else {
+      // keep the list in order so a reset walks every chunk again
+      chunk->next = arenaCurrent->next;
+      arenaCurrent->next = chunk;
+    }
+  }
+  arenaCurrent = chunk;
+  block = (char*) chunk->data + chunk->used;
+  chunk->used += size;
+  return block;
+}
+
+void resetArena(void) {
+  ArenaChunk *chunk;
+
+  for (chunk = arenaChunks; chunk != NULL; chunk = chunk->next)
+    chunk->used = 0;
+  arenaCurrent = arenaChunks;
+}
+
+/******************* Allocation ******************************/
+
+void* allocate(size_t size, const char *file, int line) {
+  AllocHeader* header;
+  AllocSite* site;
+
+  if (useArena)
+    return arenaAllocate(size);
+  if (!trackAllocations)
+    return malloc(size);
+
+  header = (AllocHeader*) malloc(sizeof(AllocHeader) + size);
+  if (header == NULL) return NULL;
+  header->info.size = size;
+  header->info.site = findSite(file, line);
+
+  allocStats.allocations ++;
+  allocStats.bytes += size;
+  allocStats.liveBytes += size;
+  if (allocStats.liveBytes > allocStats.peakLiveBytes)
+    allocStats.peakLiveBytes = allocStats.liveBytes;
+
+  site = &allocSites[header->info.site];
+  site->allocations ++;
+  site->bytes += size;
+  site->liveBlocks ++;
+  site->liveBytes += size;
+  if (site->liveBytes > site->peakLiveBytes)
+    site->peakLiveBytes = site->liveBytes;
+  return header + 1;
+}
+
+void deallocate(void* ptr) {
+  AllocHeader* header;
+
+  if (ptr == NULL || useArena) return;
+  if (!trackAllocations) {
+    free(ptr);
+    return;
+  }
+
+  header = ((AllocHeader*) ptr) - 1;
+  allocStats.frees ++;
+  allocStats.liveBytes -= header->info.size;
+  allocSites[header->info.site].liveBlocks --;
+  allocSites[header->info.site].liveBytes -= header->info.size;
+  free(header);
+}
@@ -0,0 +1,46 @@
+#ifndef __ALLOC_H__
+#define __ALLOC_H__
+
+#include <stddef.h>
+
+/* Every compiler data structure is allocated and released through these
+   two macros so that heap traffic can be accounted for, per call site */
+#define ALLOC(size) allocate(size, __FILE__, __LINE__)
+#define FREE(ptr) deallocate(ptr)
+
+#define MAX_ALLOC_SITES 256
+
+struct AllocStats_ {
+  long long allocations;
+  long long frees;
+  long long bytes;
+  long long liveBytes;
+  long long peakLiveBytes;
+};
+
+typedef struct AllocStats_ AllocStats;
+
+struct AllocSite_ {
+  const char *file;
+  int line;
+  long long allocations;
+  long long bytes;
+  long long liveBlocks;
+  long long liveBytes;
+  long long peakLiveBytes;
+};
+
+typedef struct AllocSite_ AllocSite;
+
+extern int trackAllocations;
+extern int useArena;
+extern AllocStats allocStats;
+extern AllocSite allocSites[MAX_ALLOC_SITES];
+extern int allocSiteCount;
+
+void* allocate(size_t size, const char *file, int line);
+void deallocate(void* ptr);
+int compareSiteBytes(const void *a, const void *b);
+void resetArena(void);
+
+#endif
@@ -0,0 +1,10 @@
+#include <stddef.h>
+
+/* The Makefile sets KPLC_BUILD_ID at link time to a checksum of every
+   object file, so any change to the sources or the compile flags gives
+   the compiler a new id. Built some other way, it has none. */
+#ifdef KPLC_BUILD_ID
+const char *kplcBuildId = KPLC_BUILD_ID;
+#else
+const char *kplcBuildId = NULL;
+#endif
@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "cache.h"
+
+#define CACHE_PATH_LEN 1024
+#define CACHE_HEADER_SIZE 32
+#define CACHE_ENTRY_SUFFIX ".out"
+#define CACHE_ENTRY_NAME_LEN 20
+#define CACHE_TMP_PREFIX "tmp."
+#define CACHE_TMP_MAX_AGE 3600
+#define CACHE_TOUCH_INTERVAL 60
+
+struct CacheEntry {
+  char name[CACHE_ENTRY_NAME_LEN + 1];
+  off_t size;
+  time_t mtime;
+};
+
+int useCache = 0;
+char *cacheDir = NULL;
+
+char defaultCacheDir[CACHE_PATH_LEN];
+char cachePath[CACHE_PATH_LEN];
+char cacheTmpPath[CACHE_PATH_LEN];
+int cacheFd = -1;
+int savedStdout = -1;
+long long compileStart;
+
+long long cacheClock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/******************* Key computation ******************************/
+
+// 64-bit FNV-1a
+unsigned long long hashBytes(unsigned long long h, const unsigned char *p, size_t n) {
+  while (n-- > 0) {
+    h ^= *p++;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+unsigned long long hashString(unsigned long long h, const char *s) {
+  return hashBytes(h, (const unsigned char *) s, strlen(s) + 1);
+}
+
+int hashFile(char *fileName, unsigned long long *h) {
+  unsigned char buffer[65536];
+  ssize_t n;
+  int fd = open(fileName, O_RDONLY);
+
+  if (fd < 0) return 0;
+  while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+    *h = hashBytes(*h, buffer, n);
+  close(fd);
+  return n == 0;
+}
+
+// The build id identifies the compiler, so a rebuild that changes its
+// output also changes every key. A compiler without one cannot cache.
+int computeKey(char *fileName, char *flags, unsigned long long *key) {
+  unsigned long long h = 14695981039346656037ULL;
+
+  if (kplcBuildId == NULL) return 0;
+  h = hashString(h, kplcBuildId);
+  if (!hashFile(fileName, &h)) return 0;
+  h = hashString(h, flags);
+  *key = h;
+  return 1;
+}
+
+/******************* Cache directory ******************************/
+
+char *resolveCacheDir(void) {
+  char *dir;
+
+  if (cacheDir != NULL) return cacheDir;
+  dir = getenv("KPLC_CACHE_DIR");
+  if (dir != NULL && dir[0] != '\0')
+    cacheDir = dir;
+  else {
+    dir = getenv("HOME");
+    snprintf(defaultCacheDir, CACHE_PATH_LEN, "%s/.cache/kplc", (dir != NULL) ? dir : ".");
+    cacheDir = defaultCacheDir;
+  }
+  return cacheDir;
+}
+
+int makeCacheDir(void) {
+  char path[CACHE_PATH_LEN];
+  char *p;
+
+  snprintf(path, CACHE_PATH_LEN, "%s", resolveCacheDir());
+  for (p = path + 1; *p != '\0'; p++)
+    if (*p == '/') {
+      *p = '\0';
+      mkdir(path, 0755);
+      *p = '/';
+    }
+  mkdir(path, 0755);
+  return access(path, W_OK) == 0;
+}
+
+long cacheMaxSize(void) {
+  char *size = getenv("KPLC_CACHE_SIZE");
+  if (size != NULL && atol(size) > 0)
+    return atol(size);
+  return CACHE_MAX_SIZE;
+}
+
+/******************* Statistics ******************************/
+
+struct CacheStats {
+  long long hits;
+  long long misses;
+  long long savedNs;
+  long long compileNs;
+};
+
+int openStats(int flags) {
+  char path[CACHE_PATH_LEN];
+  snprintf(path, CACHE_PATH_LEN, "%s/stats", resolveCacheDir());
+  return open(path, flags, 0644);
+}
+
+void readStats(int fd, struct CacheStats *stats) {
+  char buffer[128];
+  ssize_t n = pread(fd, buffer, sizeof(buffer) - 1, 0);
+
+  memset(stats, 0, sizeof(struct CacheStats));
+  if (n <= 0) return;
+  buffer[n] = '\0';
+  sscanf(buffer, "%lld %lld %lld %lld", &stats->hits, &stats->misses, &stats->savedNs, &stats->compileNs);
+}
+
+void updateStats(int hit, long long compileNs, long long savedNs) {
+  struct CacheStats stats;
+  char buffer[128];
+  int n;
+  int fd = openStats(O_RDWR | O_CREAT);
+
+  if (fd < 0) return;
+  flock(fd, LOCK_EX);
+  readStats(fd, &stats);
+  if (hit) {
+    stats.hits ++;
+    stats.savedNs += savedNs;
+  } else {
+    stats.misses ++;
+    stats.compileNs += compileNs;
+  }
+  // Fixed-width fields overwrite the record in place; truncating the file
+  // first would cost a journaled metadata update on every lookup
+  n = snprintf(buffer, sizeof(buffer), "%19lld %19lld %19lld %19lld\n",
+	       stats.hits, stats.misses, stats.savedNs, stats.compileNs);
+  pwrite(fd, buffer, n, 0);
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+
+/******************* Entries ******************************/
+
+int isCacheEntry(char *name) {
+  int len = strlen(name);
+  return (len == CACHE_ENTRY_NAME_LEN) &&
+    (strcmp(name + len - strlen(CACHE_ENTRY_SUFFIX), CACHE_ENTRY_SUFFIX) == 0);
+}
+
+int listEntries(struct CacheEntry **entries, long *totalSize) {
+  char path[CACHE_PATH_LEN];
+  struct dirent *d;
+  struct stat st;
+  int count = 0, capacity = 0;
+  DIR *dir = opendir(resolveCacheDir());
+
+  *entries = NULL;
+  *totalSize = 0;
+  if (dir == NULL) return 0;
+  while ((d = readdir(dir)) != NULL) {
+    if (!isCacheEntry(d->d_name)) continue;
+    snprintf(path, CACHE_PATH_LEN, "%s/%s", cacheDir, d->d_name);
+    if (stat(path, &st) != 0) continue;
+    if (count == capacity) {
+      capacity = (capacity == 0) ? 64 : capacity * 2;
+      *entries = (struct CacheEntry *) realloc(*entries, capacity * sizeof(struct CacheEntry));
+    }
+    strcpy((*entries)[count].name, d->d_name);
+    (*entries)[count].size = st.st_size;
+    (*entries)[count].mtime = st.st_mtime;
+    *totalSize += st.st_size;
+    count ++;
+  }
+  closedir(dir);
+  return count;
+}
+
+int compareEntryAge(const void *a, const void *b) {
+  time_t ta = ((const struct CacheEntry *) a)->mtime;
+  time_t tb = ((const struct CacheEntry *) b)->mtime;
+  return (ta > tb) - (ta < tb);
+}
+
+int isCacheTmpFile(char *name) {
+  return strncmp(name, CACHE_TMP_PREFIX, strlen(CACHE_TMP_PREFIX)) == 0;
+}
+
+// Temporary files of compiles that crashed before publishing their entry.
+// Young ones may still belong to a compile in progress and are kept.
+void sweepTmpFiles(void) {
+  char path[CACHE_PATH_LEN];
+  struct dirent *d;
+  struct stat st;
+  time_t now = time(NULL);
+  DIR *dir = opendir(resolveCacheDir());
+
+  if (dir == NULL) return;
+  while ((d = readdir(dir)) != NULL) {
+    if (!isCacheTmpFile(d->d_name)) continue;
+    snprintf(path, CACHE_PATH_LEN, "%s/%s", cacheDir, d->d_name);
+    if (stat(path, &st) == 0 && now - st.st_mtime > CACHE_TMP_MAX_AGE)
+      unlink(path);
+  }
+  closedir(dir);
+}
+
+// Drop least recently used entries until the cache fits its size bound
+void evictEntries(void) {
+  char path[CACHE_PATH_LEN];
+  struct CacheEntry *entries;
+  long totalSize, maxSize = cacheMaxSize();
+  int i, count = listEntries(&entries, &totalSize);
+
+  if (totalSize > maxSize) {
+    qsort(entries, count, sizeof(struct CacheEntry), compareEntryAge);
+    for (i = 0; i < count && totalSize > maxSize; i++) {
+      snprintf(path, CACHE_PATH_LEN, "%s/%s", cacheDir, entries[i].name);
+      if (unlink(path) == 0)
+	totalSize -= entries[i].size;
+    }
+  }
+  free(entries);
+}
+
+int copyFd(int from, off_t offset, int to) {
+  char buffer[65536];
+  ssize_t n;
+
+  while ((n = pread(from, buffer, sizeof(buffer), offset)) > 0) {
+    if (write(to, buffer, n) != n) return 0;
+    offset += n;
+  }
+  return n == 0;
+}
+
+/******************* Lookup and store ******************************/
+
+int cacheLookup(char *fileName, char *flags) {
+  char header[CACHE_HEADER_SIZE + 1];
+  unsigned long long key;
+  long long start = cacheClock();
+  long long compileNs, savedNs;
+  struct stat st;
+  int fd;
+
+  if (!computeKey(fileName, flags, &key)) {
+    useCache = 0;
+    return CACHE_MISS;
+  }
+  snprintf(cachePath, CACHE_PATH_LEN, "%s/%016llx%s", resolveCacheDir(), key, CACHE_ENTRY_SUFFIX);
+
+  // The directory only has to be created when there is something to store
+  fd = open(cachePath, O_RDONLY);
+  if (fd < 0) {
+    if (!makeCacheDir())
+      useCache = 0;
+    return CACHE_MISS;
+  }
+  if (pread(fd, header, CACHE_HEADER_SIZE, 0) != CACHE_HEADER_SIZE) {
+    close(fd);
+    return CACHE_MISS;
+  }
+  header[CACHE_HEADER_SIZE] = '\0';
+  if (sscanf(header, "KPLC1 %lld", &compileNs) != 1) {
+    close(fd);
+    return CACHE_MISS;
+  }
+
+  fflush(stdout);
+  copyFd(fd, CACHE_HEADER_SIZE, STDOUT_FILENO);
+  // Eviction only needs a coarse age, so a hot entry is touched at most
+  // once per CACHE_TOUCH_INTERVAL
+  if (fstat(fd, &st) == 0 && time(NULL) - st.st_mtime > CACHE_TOUCH_INTERVAL)
+    futimens(fd, NULL);
+  close(fd);
+
+  savedNs = compileNs - (cacheClock() - start);
+  updateStats(1, 0, (savedNs > 0) ? savedNs : 0);
+  return CACHE_HIT;
+}
+
+void cacheEnd(void) {
+  char header[CACHE_HEADER_SIZE + 1];
+  long long compileNs = cacheClock() - compileStart;
+
+  fflush(stdout);
+  dup2(savedStdout, STDOUT_FILENO);
+  close(savedStdout);
+
+  snprintf(header, sizeof(header), "KPLC1 %025lld\n", compileNs);
+  if (pwrite(cacheFd, header, CACHE_HEADER_SIZE, 0) == CACHE_HEADER_SIZE) {
+    copyFd(cacheFd, CACHE_HEADER_SIZE, STDOUT_FILENO);
+    close(cacheFd);
+    // rename publishes the complete entry atomically
+    if (rename(cacheTmpPath, cachePath) != 0)
+      unlink(cacheTmpPath);
+  } else {
+    copyFd(cacheFd, CACHE_HEADER_SIZE, STDOUT_FILENO);
+    close(cacheFd);
+    unlink(cacheTmpPath);
+  }
+
+  updateStats(0, compileNs, 0);
+  sweepTmpFiles();
+  evictEntries();
+}
+
+// Captures everything the compiler prints, including error messages
+// printed right before exit(), and stores it when the process exits.
+void cacheBegin(void) {
+  char header[CACHE_HEADER_SIZE];
+
+  if (!useCache) return;
+  snprintf(cacheTmpPath, CACHE_PATH_LEN, "%s/" CACHE_TMP_PREFIX "XXXXXX", cacheDir);
+  cacheFd = mkstemp(cacheTmpPath);
+  if (cacheFd < 0) return;
+  fchmod(cacheFd, 0644);
+
+  memset(header, ' ', CACHE_HEADER_SIZE);
+  if (write(cacheFd, header, CACHE_HEADER_SIZE) != CACHE_HEADER_SIZE) {
+    close(cacheFd);
+    unlink(cacheTmpPath);
+    return;
+  }
+
+  fflush(stdout);
+  savedStdout = dup(STDOUT_FILENO);
+  dup2(cacheFd, STDOUT_FILENO);
+  compileStart = cacheClock();
+  atexit(cacheEnd);
+}
+
+void printCacheStats(FILE *out) {
+  struct CacheStats stats;
+  struct CacheEntry *entries;
+  long totalSize;
+  long long lookups;
+  int count, fd;
+
+  fd = openStats(O_RDONLY);
+  if (fd >= 0) {
+    flock(fd, LOCK_SH);
+    readStats(fd, &stats);
+    close(fd);
+  } else memset(&stats, 0, sizeof(struct CacheStats));
+
+  count = listEntries(&entries, &totalSize);
+  free(entries);
+
+  lookups = stats.hits + stats.misses;
+  fprintf(out, "Cache directory: %s\n", cacheDir);
+  fprintf(out, "Entries: %d (%ld bytes, limit %ld)\n", count, totalSize, cacheMaxSize());
+  fprintf(out, "Hits: %lld, misses: %lld, hit rate: %.1f%%\n", stats.hits, stats.misses,
+	  (lookups > 0) ? 100.0 * stats.hits / lookups : 0.0);
+  fprintf(out, "Compile time on misses: %.3f ms\n", stats.compileNs / 1e6);
+  fprintf(out, "Time saved by hits: %.3f ms\n", stats.savedNs / 1e6);
+}
@@ -0,0 +1,19 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdio.h>
+
+#define CACHE_MISS 0
+#define CACHE_HIT 1
+
+#define CACHE_MAX_SIZE (64L * 1024 * 1024)
+
+extern int useCache;
+extern char *cacheDir;
+extern const char *kplcBuildId;
+
+int cacheLookup(char *fileName, char *flags);
+void cacheBegin(void);
+void printCacheStats(FILE *out);
+
+#endif
@@ -7,6 +7,8 @@
 #include <stdio.h>
 #include "debug.h"
 
+int printLayout = 0;
+
 void pad(int n) {
   int i;
   for (i = 0; i < n ; i++) printf(" ");
@@ -20,6 +22,9 @@ void printType(Type* type) {
   case TP_CHAR:
     printf("Char");
     break;
+  case TP_BYTE:
+    printf("Byte");
+    break;
   case TP_ARRAY:
     printf("Arr(%d,",type->arraySize);
     printType(type->elementType);
@@ -41,6 +46,10 @@ void printConstantValue(ConstantValue* value) {
   }
 }
 
+void printScopeLayout(Scope* scope) {
+  printf(" [level %d, frame %d]", scope->level, scope->frameSize);
+}
+
 void printObject(Object* obj, int indent) {
   switch (obj->kind) {
   case OBJ_CONSTANT:
@@ -52,11 +61,15 @@ void printObject(Object* obj, int indent) {
     pad(indent);
     printf("Type %s = ", obj->name);
     printType(obj->typeAttrs->actualType);
+    if (printLayout)
+      printf(" [size %d]", sizeOfType(obj->typeAttrs->actualType));
     break;
   case OBJ_VARIABLE:
     pad(indent);
     printf("Var %s : ", obj->name);
     printType(obj->varAttrs->type);
+    if (printLayout)
+      printf(" [offset %d, size %d]", obj->varAttrs->localOffset, sizeOfType(obj->varAttrs->type));
     break;
   case OBJ_PARAMETER:
     pad(indent);
@@ -65,22 +78,33 @@ void printObject(Object* obj, int indent) {
     else
       printf("Param VAR %s : ", obj->name);
     printType(obj->paramAttrs->type);
+    if (printLayout)
+      printf(" [offset %d, size %d]", obj->paramAttrs->localOffset,
+	     (obj->paramAttrs->kind == PARAM_VALUE) ? sizeOfType(obj->paramAttrs->type) : REF_SIZE);
     break;
   case OBJ_FUNCTION:
     pad(indent);
     printf("Function %s : ",obj->name);
     printType(obj->funcAttrs->returnType);
+    if (printLayout)
+      printScopeLayout(obj->funcAttrs->scope);
     printf("\n");
     printScope(obj->funcAttrs->scope, indent + 4);
     break;
   case OBJ_PROCEDURE:
     pad(indent);
-    printf("Procedure %s\n",obj->name);
+    printf("Procedure %s",obj->name);
+    if (printLayout)
+      printScopeLayout(obj->procAttrs->scope);
+    printf("\n");
     printScope(obj->procAttrs->scope, indent + 4);
     break;
   case OBJ_PROGRAM:
     pad(indent);
-    printf("Program %s\n",obj->name);
+    printf("Program %s",obj->name);
+    if (printLayout)
+      printScopeLayout(obj->progAttrs->scope);
+    printf("\n");
     printScope(obj->progAttrs->scope, indent + 4);
     break;
   }
@@ -9,6 +9,8 @@
 
 #include "symtab.h"
 
+extern int printLayout;
+
 void printType(Type* type);
 void printConstantValue(ConstantValue* value);
 void printObject(Object* obj, int indent);
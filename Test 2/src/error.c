@@ -48,18 +48,33 @@ struct ErrorMessage errors[30] = {
   {ERR_INVALID_ASSIGNMENT, "Invalid assignment."}
 };
 
+// Set by a compile server, which goes on to the next request instead of
+// exiting after the first error
+jmp_buf *errorRecovery = NULL;
+
+// Set once a compile ends at an error; nothing is torn down after that, so
+// the blocks still live at exit are not leaks
+int compileStopped = 0;
+
+void stopCompiling(void) {
+  compileStopped = 1;
+  if (errorRecovery != NULL)
+    longjmp(*errorRecovery, 1);
+  exit(0);
+}
+
 void error(ErrorCode err, int lineNo, int colNo) {
   int i;
   for (i = 0 ; i < NUM_OF_ERRORS; i ++) 
     if (errors[i].errorCode == err) {
       printf("%d-%d:%s\n", lineNo, colNo, errors[i].message);
-      exit(0);
+      stopCompiling();
     }
 }
 
 void missingToken(TokenType tokenType, int lineNo, int colNo) {
   printf("%d-%d:Missing %s\n", lineNo, colNo, tokenToString(tokenType));
-  exit(0);
+  stopCompiling();
 }
 
 void assert(char *msg) {
@@ -6,6 +6,7 @@
 
 #ifndef __ERROR_H__
 #define __ERROR_H__
+#include <setjmp.h>
 #include "token.h"
 
 typedef enum {
@@ -41,6 +42,9 @@ typedef enum {
   ERR_INVALID_ASSIGNMENT
 } ErrorCode;
 
+extern jmp_buf *errorRecovery;
+extern int compileStopped;
+
 void error(ErrorCode err, int lineNo, int colNo);
 void missingToken(TokenType tokenType, int lineNo, int colNo);
 void assert(char *msg);
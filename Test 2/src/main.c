@@ -6,19 +6,109 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "reader.h"
 #include "parser.h"
+#include "debug.h"
+#include "cache.h"
+#include "server.h"
+#include "report.h"
+#include "trace.h"
+#include "perf.h"
+#include "stats.h"
 
 /******************************************************************/
 
 int main(int argc, char *argv[]) {
-  if (argc <= 1) {
+  char *fileName = NULL;
+  char *serverPath = NULL;
+  char *clientPath = NULL;
+  char *outputFlags;
+  int showCacheStats = 0;
+  int repeat = 1;
+  int result;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--layout") == 0)
+      printLayout = 1;
+    else if (strcmp(argv[i], "--cache") == 0)
+      useCache = 1;
+    else if (strncmp(argv[i], "--cache-dir=", 12) == 0) {
+      useCache = 1;
+      cacheDir = argv[i] + 12;
+    } else if (strcmp(argv[i], "--cache-stats") == 0)
+      showCacheStats = 1;
+    else if (strcmp(argv[i], "--time-report") == 0)
+      timeReport = 1;
+    else if (strcmp(argv[i], "--mem-report") == 0)
+      memReport = 1;
+    else if (strcmp(argv[i], "--report-format=json") == 0)
+      jsonReport = 1;
+    else if (strcmp(argv[i], "--report-format=text") == 0)
+      jsonReport = 0;
+    else if (strcmp(argv[i], "--perf-counters") == 0)
+      perfCounters = 1;
+    else if (strcmp(argv[i], "--stats") == 0)
+      showStats = 1;
+    else if (strncmp(argv[i], "--repeat=", 9) == 0 && atoi(argv[i] + 9) > 0)
+      repeat = atoi(argv[i] + 9);
+    else if (strncmp(argv[i], "--trace=", 8) == 0)
+      traceFileName = argv[i] + 8;
+    else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc)
+      serverPath = argv[++i];
+    else if (strcmp(argv[i], "--client") == 0 && i + 1 < argc)
+      clientPath = argv[++i];
+    else if (argv[i][0] == '-') {
+      printf("parser: unknown option %s\n", argv[i]);
+      return -1;
+    } else fileName = argv[i];
+  }
+
+  if (showCacheStats) {
+    printCacheStats(stdout);
+    return 0;
+  }
+
+  if (serverPath != NULL)
+    return runServer(serverPath);
+
+  if (fileName == NULL) {
     printf("parser: no input file.\n");
     return -1;
   }
 
-  if (compile(argv[1]) == IO_ERROR) {
+  outputFlags = printLayout ? "--layout" : "";
+  startReport();
+  startTrace();
+
+  // statistics describe this compilation, not a cached or remote one
+  if (showStats) {
+    if (!startStats()) return -1;
+    useCache = 0;
+    clientPath = NULL;
+  }
+
+  if (useCache) {
+    if (cacheLookup(fileName, outputFlags) == CACHE_HIT)
+      return 0;
+    cacheBegin();
+  }
+
+  if (clientPath != NULL) {
+    result = runClient(clientPath, fileName, outputFlags);
+    if (result == SERVER_UNAVAILABLE)
+      result = compile(fileName);
+  } else {
+    // --repeat compiles the file several times in one process, so that
+    // benchmarks time enough work to rise above timer noise
+    result = compile(fileName);
+    for (i = 1; i < repeat && result == IO_SUCCESS; i++)
+      result = compile(fileName);
+  }
+
+  if (result == IO_ERROR) {
     printf("Can\'t read input file!\n");
     return -1;
   }
@@ -12,6 +12,10 @@
 #include "semantics.h"
 #include "error.h"
 #include "debug.h"
+#include "alloc.h"
+#include "report.h"
+#include "trace.h"
+#include "stats.h"
 
 Token *currentToken;
 Token *lookAhead;
@@ -24,7 +28,7 @@ void scan(void) {
   Token* tmp = currentToken;
   currentToken = lookAhead;
   lookAhead = getValidToken();
-  free(tmp);
+  FREE(tmp);
 }
 
 void eat(TokenType tokenType) {
@@ -40,6 +44,7 @@ void compileProgram(void) {
   eat(TK_IDENT);
 
   program = createProgramObject(currentToken->string);
+  TRACE_BEGIN(currentToken->string, "program", currentToken->lineNo);
   enterBlock(program->progAttrs->scope);
 
   eat(SB_SEMICOLON);
@@ -48,6 +53,7 @@ void compileProgram(void) {
   eat(SB_PERIOD);
 
   exitBlock();
+  TRACE_END();
 }
 
 void compileBlock(void) {
@@ -139,6 +145,7 @@ void compileFuncDecl(void) {
   eat(KW_FUNCTION);
   eat(TK_IDENT);
 
+  TRACE_BEGIN(currentToken->string, "function", currentToken->lineNo);
   checkFreshIdent(currentToken->string);
   funcObj = createFunctionObject(currentToken->string);
   declareObject(funcObj);
@@ -156,6 +163,7 @@ void compileFuncDecl(void) {
   eat(SB_SEMICOLON);
 
   exitBlock();
+  TRACE_END();
 }
 
 void compileProcDecl(void) {
@@ -164,6 +172,7 @@ void compileProcDecl(void) {
   eat(KW_PROCEDURE);
   eat(TK_IDENT);
 
+  TRACE_BEGIN(currentToken->string, "procedure", currentToken->lineNo);
   checkFreshIdent(currentToken->string);
   procObj = createProcedureObject(currentToken->string);
   declareObject(procObj);
@@ -177,6 +186,7 @@ void compileProcDecl(void) {
   eat(SB_SEMICOLON);
 
   exitBlock();
+  TRACE_END();
 }
 
 ConstantValue* compileUnsignedConstant(void) {
@@ -269,6 +279,10 @@ Type* compileType(void) {
     eat(KW_CHAR); 
     type = makeCharType();
     break;
+  case KW_BYTE:
+    eat(KW_BYTE);
+    type = makeByteType();
+    break;
   case KW_ARRAY:
     eat(KW_ARRAY);
     eat(SB_LSEL);
@@ -305,6 +319,10 @@ Type* compileBasicType(void) {
     eat(KW_CHAR); 
     type = makeCharType();
     break;
+  case KW_BYTE:
+    eat(KW_BYTE);
+    type = makeByteType();
+    break;
   default:
     error(ERR_INVALID_BASICTYPE, lookAhead->lineNo, lookAhead->colNo);
     break;
@@ -359,83 +377,62 @@ void compileStatements(void) {
   }
 }
 
-void compileMultipleAssignSt(void) {
-  // Parse the left-hand side variables
-  ObjectNode *lhs = NULL, *lastLhs = NULL;
-  do {
-    Object *var = findObject(symtab->currentScope->objList, currentToken->string);
-    if (var == NULL) {
-      error(ERR_UNDECLARED_VARIABLE, currentToken->lineNo, currentToken->colNo);
-    }
-    ObjectNode *node = (ObjectNode *)malloc(sizeof(ObjectNode));
-    node->object = var;
-    node->next = NULL;
-    if (lhs == NULL) {
-      lhs = node;
-    } else {
-      lastLhs->next = node;
-    }
-    lastLhs = node;
-    eat(TK_IDENT);
-    if (currentToken->tokenType == SB_COMMA) {
-      eat(SB_COMMA);
-    } else {
-      break;
-    }
-  } while (1);
+// Temporary objects that only carry the type of one side of an assignment
+void addAssignOperand(ObjectNode **list, Type* type) {
+  Object* operand = (Object*) ALLOC(sizeof(Object));
+  operand->kind = OBJ_VARIABLE;
+  operand->varAttrs = (VariableAttributes*) ALLOC(sizeof(VariableAttributes));
+  operand->varAttrs->type = type;
+  addObject(list, operand);
+}
+
+// The types belong to the symbol table or to intType/charType
+void freeAssignOperands(ObjectNode *list) {
+  while (list != NULL) {
+    ObjectNode* node = list;
+    list = list->next;
+    FREE(node->object->varAttrs);
+    FREE(node->object);
+    FREE(node);
+  }
+}
+
+void compileMultipleAssignSt(Type* firstType) {
+  ObjectNode *lhs = NULL, *rhs = NULL;
+  ObjectNode *lhsNode, *rhsNode;
+
+  addAssignOperand(&lhs, firstType);
+  while (lookAhead->tokenType == SB_COMMA) {
+    eat(SB_COMMA);
+    addAssignOperand(&lhs, compileLValue());
+  }
 
-  // Parse the assignment operator
   eat(SB_ASSIGN);
 
-  // Parse the right-hand side expressions
-  ObjectNode *rhs = NULL, *lastRhs = NULL;
-  do {
-    Type *type = compileExpression();
-    ObjectNode *node = (ObjectNode *)malloc(sizeof(ObjectNode));
-    node->object = (Object *)malloc(sizeof(Object));
-    node->object->varAttrs = (VariableAttributes *)malloc(sizeof(VariableAttributes));
-    node->object->varAttrs->type = type;
-    node->next = NULL;
-    if (rhs == NULL) {
-      rhs = node;
-    } else {
-      lastRhs->next = node;
-    }
-    lastRhs = node;
-    if (currentToken->tokenType == SB_COMMA) {
-      eat(SB_COMMA);
-    } else {
-      break;
-    }
-  } while (1);
+  addAssignOperand(&rhs, compileExpression());
+  while (lookAhead->tokenType == SB_COMMA) {
+    eat(SB_COMMA);
+    addAssignOperand(&rhs, compileExpression());
+  }
 
-  // Semantic checks
-  ObjectNode *lhsNode = lhs;
-  ObjectNode *rhsNode = rhs;
+  lhsNode = lhs;
+  rhsNode = rhs;
   while (lhsNode != NULL && rhsNode != NULL) {
     checkTypeEquality(lhsNode->object->varAttrs->type, rhsNode->object->varAttrs->type);
     lhsNode = lhsNode->next;
     rhsNode = rhsNode->next;
   }
-  if (lhsNode != NULL || rhsNode != NULL) {
+  if (lhsNode != NULL || rhsNode != NULL)
     error(ERR_INVALID_ASSIGNMENT, currentToken->lineNo, currentToken->colNo);
-  }
+
+  freeAssignOperands(lhs);
+  freeAssignOperands(rhs);
 }
 
 void compileStatement(void) {
   switch (lookAhead->tokenType) {
   case TK_IDENT:
-    eat(TK_IDENT); // First consume the identifier
-    // Now check for multiple assignment or single assignment
-    if (lookAhead->tokenType == SB_COMMA) {
-      // Multiple assignment case
-      currentToken = lookAhead; // Reset current token to handle multiple assignments
-      compileMultipleAssignSt();
-    } else {
-      // Single assignment case
-      currentToken = lookAhead; // Reset for normal assignment
-      compileAssignSt(); 
-    }
+    compileAssignSt();
     break;
   case KW_CALL:
     compileCallSt();
@@ -465,13 +462,24 @@ void compileStatement(void) {
 Type* compileLValue(void) {
   // TODO: parse a lvalue (a variable, an array element, a parameter, the current function identifier)
   Object* var;
-  Type* varType;
+  Type* varType = NULL;
 
   eat(TK_IDENT);
   // check if the identifier is a function identifier, or a variable identifier, or a parameter  
   var = checkDeclaredLValueIdent(currentToken->string);
-  if (var->kind == OBJ_VARIABLE)
+  switch (var->kind) {
+  case OBJ_VARIABLE:
     varType = compileIndexes(var->varAttrs->type);
+    break;
+  case OBJ_PARAMETER:
+    varType = var->paramAttrs->type;
+    break;
+  case OBJ_FUNCTION:
+    varType = var->funcAttrs->returnType;
+    break;
+  default:
+    break;
+  }
 
   return varType;
 }
@@ -479,8 +487,14 @@ Type* compileLValue(void) {
 void compileAssignSt(void) {
   // TODO: parse the assignment and check type consistency
   Type* varType = compileLValue();
+  Type* expType;
+
+  if (lookAhead->tokenType == SB_COMMA) {
+    compileMultipleAssignSt(varType);
+    return;
+  }
   eat(SB_ASSIGN);
-  Type* expType = compileExpression();
+  expType = compileExpression();
   checkTypeEquality(varType, expType);
 }
 
@@ -545,6 +559,9 @@ void compileArgument(Object* param) {
   //       If the corresponding parameter is a reference, the argument must be a lvalue
   Type* argType = compileExpression();
   checkTypeEquality(param->paramAttrs->type, argType);
+  // a reference must point at storage of exactly the parameter's type
+  if (param->paramAttrs->kind == PARAM_REFERENCE && !compareType(param->paramAttrs->type, argType))
+    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
 }
 
 void compileArguments(ObjectNode* paramList) {
@@ -565,6 +582,7 @@ void compileArguments(ObjectNode* paramList) {
     eat(SB_RPAR);
     break;
     // Check FOLLOW set 
+  case SB_POWER:
   case SB_TIMES:
   case SB_SLASH:
   case SB_PLUS:
@@ -629,11 +647,13 @@ Type* compileExpression(void) {
     eat(SB_PLUS);
     type = compileExpression2();
     checkIntType(type);
+    type = intType;
     break;
   case SB_MINUS:
     eat(SB_MINUS);
     type = compileExpression2();
     checkIntType(type);
+    type = intType;
     break;
   default:
     type = compileExpression2();
@@ -644,40 +664,36 @@ Type* compileExpression(void) {
 Type* compileExpression2(void) {
   Type* type1;
   Type* type2;
+  STAT(int outerChain = beginChain());
 
   type1 = compileTerm();
   type2 = compileExpression3();
-  if (type2 == NULL) return type1;
-  else {
+  if (type2 != NULL) {
     checkTypeEquality(type1,type2);
-    return type1;
+    type1 = intType;
   }
+  STAT(endChain(outerChain));
+  return type1;
 }
 
 
+// Loops over the operands so a long chain does not grow the stack
 Type* compileExpression3(void) {
-  Type* type1;
-  Type* type2;
+  Type* type = NULL;
+  Type* termType;
+
+  while (lookAhead->tokenType == SB_PLUS || lookAhead->tokenType == SB_MINUS) {
+    if (lookAhead->tokenType == SB_PLUS)
+      eat(SB_PLUS);
+    else eat(SB_MINUS);
+    STAT(extendChain());
+    termType = compileTerm();
+    checkIntType(termType);
+    if (type == NULL)
+      type = termType;
+  }
 
   switch (lookAhead->tokenType) {
-  case SB_PLUS:
-    eat(SB_PLUS);
-    type1 = compileTerm();
-    checkIntType(type1);
-    type2 = compileExpression3();
-    if (type2 != NULL)
-      checkIntType(type2);
-    return type1;
-    break;
-  case SB_MINUS:
-    eat(SB_MINUS);
-    type1 = compileTerm();
-    checkIntType(type1);
-    type2 = compileExpression3();
-    if (type2 != NULL)
-      checkIntType(type2);
-    return type1;
-    break;
     // check the FOLLOW set
   case KW_TO:
   case KW_DO:
@@ -694,41 +710,43 @@ Type* compileExpression3(void) {
   case KW_END:
   case KW_ELSE:
   case KW_THEN:
-    return NULL;
     break;
   default:
     error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
   }
-  return NULL; // Ensure a return value
+  return type;
 }
 
 Type* compileTerm(void) {
   // TODO: check type of Term2
   Type* type;
 
-  type = compileFactor();
+  type = compilePower();
+  if (lookAhead->tokenType == SB_TIMES || lookAhead->tokenType == SB_SLASH) {
+    // arithmetic on BYTE operands yields an INTEGER
+    checkIntType(type);
+    type = intType;
+  }
   compileTerm2();
 
   return type;
 }
 
+// Loops over the operands so a long chain does not grow the stack
 void compileTerm2(void) {
   // TODO: check type of term2
   Type* type;
 
-  switch (lookAhead->tokenType) {
-  case SB_TIMES:
-    eat(SB_TIMES);
-    type = compileFactor();
+  while (lookAhead->tokenType == SB_TIMES || lookAhead->tokenType == SB_SLASH) {
+    if (lookAhead->tokenType == SB_TIMES)
+      eat(SB_TIMES);
+    else eat(SB_SLASH);
+    STAT(extendChain());
+    type = compilePower();
     checkIntType(type);
-    compileTerm2();
-    break;
-  case SB_SLASH:
-    eat(SB_SLASH);
-    type = compileFactor();
-    checkIntType(type);
-    compileTerm2();
-    break;
+  }
+
+  switch (lookAhead->tokenType) {
     // check the FOLLOW set
   case SB_PLUS:
   case SB_MINUS:
@@ -753,6 +771,32 @@ void compileTerm2(void) {
   }
 }
 
+// ** binds tighter than * and / and groups to the right.
+// x ** n on INTEGERs, for the code generator to implement:
+//   n > 0  the product of n copies of x, wrapped to a 32-bit two's
+//          complement value as each multiplication overflows
+//   n = 0  1 for every x, including 0 ** 0
+//   n < 0  1 / x ** -n truncated toward zero: 1 for x = 1, 1 or -1
+//          by the parity of n for x = -1, a division by zero run-time
+//          error for x = 0, and 0 for every other x
+Type* compilePower(void) {
+  Type* type;
+
+  // Every operand of a chain is an INTEGER and so is the result, so the
+  // right grouping needs no recursion to check; looping keeps the stack flat
+  type = compileFactor();
+  if (lookAhead->tokenType != SB_POWER)
+    return type;
+  while (lookAhead->tokenType == SB_POWER) {
+    eat(SB_POWER);
+    STAT(extendChain());
+    checkIntType(type);
+    type = compileFactor();
+  }
+  checkIntType(type);
+  return intType;
+}
+
 Type* compileFactor(void) {
   Object* obj;
   Type* type = NULL;
@@ -811,12 +855,12 @@ Type* compileSumExpression(void) {
   Type* expType;
   
   expType = compileExpression();
-  checkIntType(expType);
+  checkSumOperandType(expType);
   
   while (lookAhead->tokenType == SB_COMMA) {
     eat(SB_COMMA);
     expType = compileExpression();
-    checkIntType(expType);
+    checkSumOperandType(expType);
   }
   
   return intType;
@@ -825,6 +869,7 @@ Type* compileSumExpression(void) {
 Type* compileIndexes(Type* arrayType) {
   // TODO: parse a sequence of indexes, check the consistency to the arrayType, and return the element type
   while (lookAhead->tokenType == SB_LSEL) {
+    checkArrayType(arrayType);
     eat(SB_LSEL);
     Type* indexType = compileExpression();
     checkIntType(indexType);
@@ -834,24 +879,51 @@ Type* compileIndexes(Type* arrayType) {
   return arrayType;
 }
 
-int compile(char *fileName) {
-  if (openInputStream(fileName) == IO_ERROR)
-    return IO_ERROR;
-
+void compileInput(void) {
   currentToken = NULL;
   lookAhead = getValidToken();
 
-  initSymTab();
+  // A compile server builds the predeclared environment once and keeps it
+  if (symtab == NULL)
+    initSymTab();
+  beginProgram();
 
   compileProgram();
 
+  TRACE_BEGIN("printObject", "output", 0);
+  BEGIN_PHASE(PHASE_OUTPUT);
   printObject(symtab->program,0);
+  END_PHASE(PHASE_OUTPUT);
+  TRACE_END();
+
+  TRACE_BEGIN("cleanSymTab", "cleanup", 0);
+  BEGIN_PHASE(PHASE_CLEANUP);
+  endProgram();
+  if (!keepSymTab)
+    cleanSymTab();
+  END_PHASE(PHASE_CLEANUP);
+  TRACE_END();
 
-  cleanSymTab();
+  FREE(currentToken);
+  FREE(lookAhead);
+}
+
+int compile(char *fileName) {
+  if (openInputStream(fileName) == IO_ERROR)
+    return IO_ERROR;
+
+  compileInput();
 
-  free(currentToken);
-  free(lookAhead);
   closeInputStream();
   return IO_SUCCESS;
+}
 
+int compileBuffer(char *buffer, int size) {
+  if (openInputBuffer(buffer, size) == IO_ERROR)
+    return IO_ERROR;
+
+  compileInput();
+
+  closeInputStream();
+  return IO_SUCCESS;
 }
@@ -35,7 +35,7 @@ void compileParams(void);
 void compileParam(void);
 void compileStatements(void);
 void compileStatement(void);
-void compileMultipleAssignSt(void);
+void compileMultipleAssignSt(Type* firstType);
 Type* compileLValue(void);
 void compileAssignSt(void);
 void compileCallSt(void);
@@ -52,10 +52,12 @@ Type* compileExpression2(void);
 Type* compileExpression3(void);
 Type* compileTerm(void);
 void compileTerm2(void);
+Type* compilePower(void);
 Type* compileFactor(void);
 Type* compileIndexes(Type* arrayType);
 Type* compileSumExpression(void);
 
 int compile(char *fileName);
+int compileBuffer(char *buffer, int size);
 
 #endif
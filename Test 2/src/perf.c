@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perf.h"
+
+int perfCounters = 0;
+
+char *perfCounterNames[PERF_COUNTERS] = {
+  "cycles", "instructions", "branch_misses", "cache_misses"
+};
+
+unsigned long long perfConfigs[PERF_COUNTERS] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_BRANCH_MISSES,
+  PERF_COUNT_HW_CACHE_MISSES
+};
+
+int perfGroupFd = -1;
+int perfOpened = 0;
+// position of each counter in a group read, -1 if it could not be opened
+int perfIndex[PERF_COUNTERS];
+
+int perfEventOpen(struct perf_event_attr *attr, int groupFd) {
+  return syscall(SYS_perf_event_open, attr, 0, -1, groupFd, 0);
+}
+
+// Opens one counter group for the calling thread. Counters the PMU or the
+// container refuses are left out; returns 0 when none could be opened.
+int openPerfCounters(void) {
+  struct perf_event_attr attr;
+  int i, fd, lastError = 0;
+
+  for (i = 0; i < PERF_COUNTERS; i++) {
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = perfConfigs[i];
+    attr.disabled = (perfGroupFd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    fd = perfEventOpen(&attr, perfGroupFd);
+    if (fd < 0) {
+      perfIndex[i] = -1;
+      lastError = errno;
+      continue;
+    }
+    if (perfGroupFd == -1) perfGroupFd = fd;
+    perfIndex[i] = perfOpened ++;
+  }
+
+  if (perfGroupFd == -1) {
+    fprintf(stderr, "kplc: hardware performance counters unavailable (%s)\n", strerror(lastError));
+    return 0;
+  }
+  ioctl(perfGroupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(perfGroupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return 1;
+}
+
+void readPerfCounters(unsigned long long values[PERF_COUNTERS]) {
+  unsigned long long buffer[1 + PERF_COUNTERS];
+  int i;
+
+  memset(buffer, 0, sizeof(buffer));
+  if (read(perfGroupFd, buffer, sizeof(buffer)) <= 0)
+    memset(buffer, 0, sizeof(buffer));
+  for (i = 0; i < PERF_COUNTERS; i++)
+    values[i] = (perfIndex[i] >= 0) ? buffer[1 + perfIndex[i]] : 0;
+}
+
+int perfCounterAvailable(PerfCounter counter) {
+  return perfGroupFd != -1 && perfIndex[counter] >= 0;
+}
@@ -0,0 +1,19 @@
+#ifndef __PERF_H__
+#define __PERF_H__
+
+typedef enum {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_BRANCH_MISSES,
+  PERF_CACHE_MISSES,
+  PERF_COUNTERS
+} PerfCounter;
+
+extern int perfCounters;
+extern char *perfCounterNames[PERF_COUNTERS];
+
+int openPerfCounters(void);
+void readPerfCounters(unsigned long long values[PERF_COUNTERS]);
+int perfCounterAvailable(PerfCounter counter);
+
+#endif
@@ -6,13 +6,33 @@
 
 #include <stdio.h>
 #include "reader.h"
+#include "report.h"
 
 FILE *inputStream;
 int lineNo, colNo;
 int currentChar;
 
+// The source is read in large blocks instead of one getc call per character.
+// A source that is already in memory is scanned in place.
+unsigned char fileBuffer[INPUT_BUFFER_SIZE];
+unsigned char *inputBuffer;
+int inputLength, inputPos;
+int inputEnd;
+
 int readChar(void) {
-  currentChar = getc(inputStream);
+  if (inputPos == inputLength && !inputEnd) {
+    BEGIN_PHASE(PHASE_READ);
+    if (inputStream == NULL)
+      inputLength = 0;
+    else inputLength = fread(inputBuffer, 1, INPUT_BUFFER_SIZE, inputStream);
+    inputPos = 0;
+    // Once the stream is drained, later calls return EOF without reading again
+    inputEnd = (inputLength == 0);
+    END_PHASE(PHASE_READ);
+  }
+  if (inputEnd)
+    currentChar = EOF;
+  else currentChar = inputBuffer[inputPos++];
   colNo ++;
   if (currentChar == '\n') {
     lineNo ++;
@@ -21,17 +41,36 @@ int readChar(void) {
   return currentChar;
 }
 
-int openInputStream(char *fileName) {
-  inputStream = fopen(fileName, "rt");
-  if (inputStream == NULL)
-    return IO_ERROR;
+int initInputStream(void) {
+  inputPos = 0;
+  inputEnd = 0;
   lineNo = 1;
   colNo = 0;
   readChar();
   return IO_SUCCESS;
 }
 
+int openInputStream(char *fileName) {
+  inputStream = fopen(fileName, "rt");
+  if (inputStream == NULL)
+    return IO_ERROR;
+  setvbuf(inputStream, NULL, _IONBF, 0);
+  inputBuffer = fileBuffer;
+  inputLength = 0;
+  return initInputStream();
+}
+
+// fmemopen would copy the buffer out again, one byte at a time when unbuffered
+int openInputBuffer(char *buffer, int size) {
+  inputStream = NULL;
+  inputBuffer = (unsigned char*) buffer;
+  inputLength = size;
+  return initInputStream();
+}
+
 void closeInputStream() {
-  fclose(inputStream);
+  if (inputStream != NULL)
+    fclose(inputStream);
+  inputStream = NULL;
 }
 
@@ -10,8 +10,11 @@
 #define IO_ERROR 0
 #define IO_SUCCESS 1
 
+#define INPUT_BUFFER_SIZE 65536
+
 int readChar(void);
 int openInputStream(char *fileName);
+int openInputBuffer(char *buffer, int size);
 void closeInputStream(void);
 
 #endif
@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "report.h"
+#include "alloc.h"
+#include "error.h"
+#include "perf.h"
+
+int timeReport = 0;
+int memReport = 0;
+int jsonReport = 0;
+
+char *phaseNames[PHASE_COUNT] = {
+  "parse", "read", "lex", "semantics", "output", "cleanup"
+};
+
+/* Each measurement is a vector: the tick count followed by the hardware
+   counters when --perf-counters is active */
+#define PHASE_VALUES (1 + PERF_COUNTERS)
+#define VALUE_TICKS 0
+
+long long phaseCalls[PHASE_COUNT];
+unsigned long long phaseStart[PHASE_COUNT];
+unsigned long long phaseStartValues[PHASE_COUNT][PHASE_VALUES];
+unsigned long long phaseExcluded[PHASE_COUNT][PHASE_VALUES];
+unsigned long long phaseExact[PHASE_COUNT][PHASE_VALUES];
+unsigned long long phaseSampled[PHASE_COUNT][PHASE_VALUES];
+long long phaseSamples[PHASE_COUNT];
+unsigned long long startValues[PHASE_VALUES];
+unsigned long long readOverhead[PHASE_VALUES];
+int countersActive = 0;
+long long startNs;
+
+long long readClock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// The time stamp counter is cheaper to read than the monotonic clock;
+// ticks are converted to nanoseconds once, when the report is printed.
+unsigned long long readTicks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return readClock();
+#endif
+}
+
+void readValues(unsigned long long values[PHASE_VALUES]) {
+  if (countersActive)
+    readPerfCounters(values + 1);
+  values[VALUE_TICKS] = readTicks();
+}
+
+void beginPhase(Phase phase) {
+  memset(phaseExcluded[phase], 0, sizeof(phaseExcluded[phase]));
+  readValues(phaseStartValues[phase]);
+  phaseStart[phase] = phaseStartValues[phase][VALUE_TICKS];
+}
+
+void endPhase(Phase phase) {
+  unsigned long long values[PHASE_VALUES];
+  unsigned long long *accumulated;
+  int i, k;
+
+  readValues(values);
+  for (k = 0; k < PHASE_VALUES; k++)
+    values[k] -= phaseStartValues[phase][k];
+
+  // what is spent in a nested phase belongs to that phase only
+  for (i = 0; i < PHASE_COUNT; i++)
+    if (i != phase && phaseStart[i] != 0 && phaseStart[i] < phaseStart[phase])
+      for (k = 0; k < PHASE_VALUES; k++)
+	phaseExcluded[i][k] += values[k];
+
+  for (k = 0; k < PHASE_VALUES; k++)
+    values[k] = (values[k] > readOverhead[k]) ? values[k] - readOverhead[k] : 0;
+  if (phaseCalls[phase] <= PHASE_SAMPLE_RATE)
+    accumulated = phaseExact[phase];
+  else {
+    accumulated = phaseSampled[phase];
+    phaseSamples[phase] ++;
+  }
+  for (k = 0; k < PHASE_VALUES; k++)
+    if (values[k] > phaseExcluded[phase][k])
+      accumulated[k] += values[k] - phaseExcluded[phase][k];
+  phaseStart[phase] = 0;
+}
+
+double estimatePhase(Phase phase, int k) {
+  double value = phaseExact[phase][k];
+  if (phaseSamples[phase] > 0)
+    value += (double) phaseSampled[phase][k] * (phaseCalls[phase] - PHASE_SAMPLE_RATE) / phaseSamples[phase];
+  return value;
+}
+
+// Reading the counters is a system call, far more expensive than the time
+// stamp counter; both costs are measured once and taken off every span.
+void measureReadOverhead(void) {
+  unsigned long long first[PHASE_VALUES], second[PHASE_VALUES];
+  int i, k;
+
+  for (k = 0; k < PHASE_VALUES; k++)
+    readOverhead[k] = ~0ULL;
+  for (i = 0; i < 16; i++) {
+    readValues(first);
+    readValues(second);
+    for (k = 0; k < PHASE_VALUES; k++)
+      if (second[k] - first[k] < readOverhead[k])
+	readOverhead[k] = second[k] - first[k];
+  }
+}
+
+/******************* Output ******************************/
+
+// Phase estimates for every value; parsing gets whatever is left of the total
+void estimatePhases(double estimates[PHASE_COUNT][PHASE_VALUES], unsigned long long totals[PHASE_VALUES]) {
+  double rest;
+  int i, k;
+
+  for (k = 0; k < PHASE_VALUES; k++) {
+    rest = totals[k];
+    for (i = PHASE_PARSE + 1; i < PHASE_COUNT; i++) {
+      estimates[i][k] = estimatePhase(i, k);
+      rest -= estimates[i][k];
+    }
+    estimates[PHASE_PARSE][k] = (rest > 0) ? rest : 0.0;
+  }
+}
+
+double perKilo(double count, double instructions) {
+  return (instructions > 0) ? 1000.0 * count / instructions : 0.0;
+}
+
+void printCounters(FILE *out, double *values) {
+  double instructions = values[1 + PERF_INSTRUCTIONS];
+
+  if (perfCounterAvailable(PERF_CYCLES) && perfCounterAvailable(PERF_INSTRUCTIONS))
+    fprintf(out, "  IPC %5.2f", (values[1 + PERF_CYCLES] > 0) ? instructions / values[1 + PERF_CYCLES] : 0.0);
+  if (perfCounterAvailable(PERF_BRANCH_MISSES) && perfCounterAvailable(PERF_INSTRUCTIONS))
+    fprintf(out, "  br-miss %6.2f/ki", perKilo(values[1 + PERF_BRANCH_MISSES], instructions));
+  if (perfCounterAvailable(PERF_CACHE_MISSES) && perfCounterAvailable(PERF_INSTRUCTIONS))
+    fprintf(out, "  cache-miss %6.2f/ki", perKilo(values[1 + PERF_CACHE_MISSES], instructions));
+}
+
+void printTimeReport(FILE *out, double nsPerTick, unsigned long long totals[PHASE_VALUES]) {
+  double estimates[PHASE_COUNT][PHASE_VALUES];
+  double totalValues[PHASE_VALUES];
+  double totalNs = totals[VALUE_TICKS] * nsPerTick;
+  double ns;
+  int i, k;
+
+  estimatePhases(estimates, totals);
+  for (k = 0; k < PHASE_VALUES; k++)
+    totalValues[k] = totals[k];
+
+  if (jsonReport) {
+    fprintf(out, "\"time\": {\"total_ms\": %.3f", totalNs / 1e6);
+    for (i = 0; i < PHASE_COUNT; i++) {
+      fprintf(out, ", \"%s_ms\": %.3f, \"%s_calls\": %lld",
+	      phaseNames[i], estimates[i][VALUE_TICKS] * nsPerTick / 1e6, phaseNames[i], phaseCalls[i]);
+      for (k = 0; k < PERF_COUNTERS; k++)
+	if (countersActive && perfCounterAvailable(k))
+	  fprintf(out, ", \"%s_%s\": %.0f", phaseNames[i], perfCounterNames[k], estimates[i][1 + k]);
+    }
+    fprintf(out, "}");
+    return;
+  }
+
+  fprintf(out, "Time report:\n");
+  for (i = 0; i < PHASE_COUNT; i++) {
+    ns = estimates[i][VALUE_TICKS] * nsPerTick;
+    fprintf(out, "  %-12s %10.3f ms %6.1f%%", phaseNames[i], ns / 1e6,
+	    (totalNs > 0) ? 100.0 * ns / totalNs : 0.0);
+    if (i != PHASE_PARSE)
+      fprintf(out, " %10lld calls", phaseCalls[i]);
+    else fprintf(out, " %16s", "");
+    if (countersActive)
+      printCounters(out, estimates[i]);
+    fprintf(out, "\n");
+  }
+  fprintf(out, "  %-12s %10.3f ms %24s", "total", totalNs / 1e6, "");
+  if (countersActive)
+    printCounters(out, totalValues);
+  fprintf(out, "\n");
+}
+
+void printAllocSites(FILE *out) {
+  AllocSite sites[MAX_ALLOC_SITES];
+  AllocSite *site;
+  char name[64];
+  int i;
+
+  // sorted on a copy, live blocks refer to their site by index
+  memcpy(sites, allocSites, allocSiteCount * sizeof(AllocSite));
+  qsort(sites, allocSiteCount, sizeof(AllocSite), compareSiteBytes);
+
+  if (jsonReport) {
+    fprintf(out, ", \"sites\": [");
+    for (i = 0; i < allocSiteCount; i++) {
+      site = &sites[i];
+      fprintf(out, "%s{\"site\": \"%s:%d\", \"allocations\": %lld, \"bytes\": %lld, "
+	      "\"peak_live_bytes\": %lld",
+	      (i > 0) ? ", " : "", site->file, site->line, site->allocations, site->bytes,
+	      site->peakLiveBytes);
+      if (compileStopped)
+	fprintf(out, ", \"leaked_blocks\": null, \"leaked_bytes\": null}");
+      else fprintf(out, ", \"leaked_blocks\": %lld, \"leaked_bytes\": %lld}",
+		   site->liveBlocks, site->liveBytes);
+    }
+    fprintf(out, "]");
+    return;
+  }
+
+  fprintf(out, "  %-18s %10s %12s %12s %8s\n", "site", "count", "bytes", "peak live", "leaked");
+  for (i = 0; i < allocSiteCount; i++) {
+    site = &sites[i];
+    snprintf(name, sizeof(name), "%s:%d", site->file, site->line);
+    fprintf(out, "  %-18s %10lld %12lld %12lld", name,
+	    site->allocations, site->bytes, site->peakLiveBytes);
+    if (compileStopped)
+      fprintf(out, " %8s\n", "-");
+    else fprintf(out, " %8lld\n", site->liveBlocks);
+  }
+}
+
+void printMemReport(FILE *out) {
+  struct rusage usage;
+
+  getrusage(RUSAGE_SELF, &usage);
+
+  if (jsonReport) {
+    fprintf(out, "\"memory\": {\"allocations\": %lld, \"frees\": %lld, \"bytes\": %lld, "
+	    "\"peak_live_bytes\": %lld, \"live_bytes\": %lld, \"peak_rss_kib\": %ld, "
+	    "\"leaks_checked\": %s",
+	    allocStats.allocations, allocStats.frees, allocStats.bytes,
+	    allocStats.peakLiveBytes, allocStats.liveBytes, usage.ru_maxrss,
+	    compileStopped ? "false" : "true");
+    printAllocSites(out);
+    fprintf(out, "}");
+    return;
+  }
+
+  fprintf(out, "Memory report:\n");
+  fprintf(out, "  %-14s %lld (%lld bytes)\n", "allocations", allocStats.allocations, allocStats.bytes);
+  fprintf(out, "  %-14s %lld\n", "frees", allocStats.frees);
+  fprintf(out, "  %-14s %lld bytes\n", "peak live", allocStats.peakLiveBytes);
+  fprintf(out, "  %-14s %lld bytes\n", "live at exit", allocStats.liveBytes);
+  fprintf(out, "  %-14s %ld KiB\n", "peak RSS", usage.ru_maxrss);
+  printAllocSites(out);
+  // error() exits without cleanSymTab, so live blocks say nothing about leaks
+  if (compileStopped)
+    fprintf(out, "  leaks not checked: the compile stopped at an error\n");
+  else if (allocStats.liveBytes > 0)
+    fprintf(out, "  leaked: %lld blocks, %lld bytes\n",
+	    allocStats.allocations - allocStats.frees, allocStats.liveBytes);
+}
+
+void printReport(void) {
+  unsigned long long totals[PHASE_VALUES];
+  long long totalNs = readClock() - startNs;
+  double nsPerTick;
+  int k;
+
+  readValues(totals);
+  for (k = 0; k < PHASE_VALUES; k++)
+    totals[k] -= startValues[k];
+  nsPerTick = (totals[VALUE_TICKS] > 0) ? (double) totalNs / totals[VALUE_TICKS] : 0.0;
+
+  if (jsonReport) fprintf(stderr, "{");
+  if (timeReport)
+    printTimeReport(stderr, nsPerTick, totals);
+  if (jsonReport && timeReport && memReport)
+    fprintf(stderr, ", ");
+  if (memReport)
+    printMemReport(stderr);
+  if (jsonReport) fprintf(stderr, "}\n");
+}
+
+// Reports go to stderr so that they never mix with the compiler output
+void startReport(void) {
+  if (perfCounters) timeReport = 1;
+  if (!timeReport && !memReport) return;
+
+  trackAllocations = memReport;
+  if (perfCounters)
+    countersActive = openPerfCounters();
+  measureReadOverhead();
+  startNs = readClock();
+  readValues(startValues);
+  atexit(printReport);
+}
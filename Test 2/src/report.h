@@ -0,0 +1,40 @@
+#ifndef __REPORT_H__
+#define __REPORT_H__
+
+typedef enum {
+  PHASE_PARSE,
+  PHASE_READ,
+  PHASE_LEX,
+  PHASE_SEMANTICS,
+  PHASE_OUTPUT,
+  PHASE_CLEANUP,
+  PHASE_COUNT
+} Phase;
+
+/* Reading the clock around every token or lookup would cost more than
+   the work being measured. The first PHASE_SAMPLE_RATE calls of a phase
+   are timed exactly, after that only one call in PHASE_SAMPLE_RATE is
+   timed and the rest is extrapolated from the call count. Parsing is
+   whatever remains of the total. */
+#define PHASE_SAMPLE_RATE 64
+
+#define BEGIN_PHASE(phase) do { \
+    if (timeReport && (++phaseCalls[phase] <= PHASE_SAMPLE_RATE || \
+		       phaseCalls[phase] % PHASE_SAMPLE_RATE == 0)) \
+      beginPhase(phase); \
+  } while (0)
+#define END_PHASE(phase) do { \
+    if (phaseStart[phase] != 0) endPhase(phase); \
+  } while (0)
+
+extern int timeReport;
+extern int memReport;
+extern int jsonReport;
+extern long long phaseCalls[PHASE_COUNT];
+extern unsigned long long phaseStart[PHASE_COUNT];
+
+void beginPhase(Phase phase);
+void endPhase(Phase phase);
+void startReport(void);
+
+#endif
@@ -13,6 +13,9 @@
 #include "token.h"
 #include "error.h"
 #include "scanner.h"
+#include "alloc.h"
+#include "report.h"
+#include "stats.h"
 
 
 extern int lineNo;
@@ -139,9 +142,13 @@ Token* getToken(void) {
     readChar(); 
     return token;
   case CHAR_TIMES:
-    token = makeToken(SB_TIMES, lineNo, colNo);
-    readChar(); 
-    return token;
+    ln = lineNo;
+    cn = colNo;
+    readChar();
+    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_TIMES)) {
+      readChar();
+      return makeToken(SB_POWER, ln, cn);
+    } else return makeToken(SB_TIMES, ln, cn);
   case CHAR_SLASH:
     token = makeToken(SB_SLASH, lineNo, colNo);
     readChar(); 
@@ -235,11 +242,16 @@ Token* getToken(void) {
 }
 
 Token* getValidToken(void) {
-  Token *token = getToken();
+  Token *token;
+
+  BEGIN_PHASE(PHASE_LEX);
+  token = getToken();
   while (token->tokenType == TK_NONE) {
-    free(token);
+    FREE(token);
     token = getToken();
   }
+  END_PHASE(PHASE_LEX);
+  STAT(countToken(token));
   return token;
 }
 
@@ -278,6 +290,7 @@ void printToken(Token *token) {
   case KW_FOR: printf("KW_FOR\n"); break;
   case KW_TO: printf("KW_TO\n"); break;
   case KW_SUM: printf("KW_SUM\n"); break;
+  case KW_BYTE: printf("KW_BYTE\n"); break;
 
   case SB_SEMICOLON: printf("SB_SEMICOLON\n"); break;
   case SB_COLON: printf("SB_COLON\n"); break;
@@ -298,6 +311,7 @@ void printToken(Token *token) {
   case SB_RPAR: printf("SB_RPAR\n"); break;
   case SB_LSEL: printf("SB_LSEL\n"); break;
   case SB_RSEL: printf("SB_RSEL\n"); break;
+  case SB_POWER: printf("SB_POWER\n"); break;
   }
 }
 
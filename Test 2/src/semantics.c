@@ -8,26 +8,33 @@
 #include <string.h>
 #include "semantics.h"
 #include "error.h"
+#include "report.h"
+#include "stats.h"
 
 extern SymTab* symtab;
 extern Token* currentToken;
 
 Object* lookupObject(char *name) {
-  Scope* scope = symtab->currentScope;
+  Binding* binding;
   Object* obj;
 
-  while (scope != NULL) {
-    obj = findObject(scope->objList, name);
-    if (obj != NULL) return obj;
-    scope = scope->outer;
-  }
-  obj = findObject(symtab->globalObjectList, name);
-  if (obj != NULL) return obj;
-  return NULL;
+  BEGIN_PHASE(PHASE_SEMANTICS);
+  STAT(stats.lookups ++);
+  binding = findBinding(name);
+  if (binding != NULL)
+    obj = binding->object;
+  else obj = findObject(symtab->globalObjectList, name);
+  END_PHASE(PHASE_SEMANTICS);
+  return obj;
 }
 
 void checkFreshIdent(char *name) {
-  if (findObject(symtab->currentScope->objList, name) != NULL)
+  Binding* binding;
+
+  BEGIN_PHASE(PHASE_SEMANTICS);
+  binding = findBinding(name);
+  END_PHASE(PHASE_SEMANTICS);
+  if (binding != NULL && binding->scope == symtab->currentScope)
     error(ERR_DUPLICATE_IDENT, currentToken->lineNo, currentToken->colNo);
 }
 
@@ -110,8 +117,13 @@ Object* checkDeclaredLValueIdent(char* name) {
 }
 
 
+// BYTE values take part in integer arithmetic
+int isIntegerType(Type* type) {
+  return (type->typeClass == TP_INT) || (type->typeClass == TP_BYTE);
+}
+
 void checkIntType(Type* type) {
-  if (type->typeClass != TP_INT)
+  if (!isIntegerType(type))
     error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
 }
 
@@ -124,12 +136,22 @@ void checkBasicType(Type* type) {
 }
 
 void checkArrayType(Type* type) {
-  // TODO
+  if (type->typeClass != TP_ARRAY)
+    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+}
+
+// SUM adds up integers and every element of an integer array
+void checkSumOperandType(Type* type) {
+  while (type->typeClass == TP_ARRAY)
+    type = type->elementType;
+  checkIntType(type);
 }
 
 void checkTypeEquality(Type* type1, Type* type2) {
   if (type1 == NULL || type2 == NULL) return;
-  if (type1->typeClass != type2->typeClass) {
+  if (isIntegerType(type1) && isIntegerType(type2)) return;
+  // arrays are assigned as a whole, so sizes and element types must match
+  if (!compareType(type1, type2)) {
     error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
   }
 }
@@ -18,10 +18,12 @@ Object* checkDeclaredFunction(char *name);
 Object* checkDeclaredProcedure(char *name);
 Object* checkDeclaredLValueIdent(char *name);
 
+int isIntegerType(Type* type);
 void checkIntType(Type* type);
 void checkCharType(Type* type);
 void checkArrayType(Type* type);
 void checkBasicType(Type* type);
+void checkSumOperandType(Type* type);
 void checkTypeEquality(Type* type1, Type* type2);
 
 #endif
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+#include "reader.h"
+#include "parser.h"
+#include "symtab.h"
+#include "error.h"
+#include "alloc.h"
+#include "debug.h"
+#include "server.h"
+
+char *serverSocketPath;
+int serverStdout;
+
+int readFully(int fd, char *buffer, int size) {
+  int n;
+  while (size > 0) {
+    n = read(fd, buffer, size);
+    if (n <= 0) return 0;
+    buffer += n;
+    size -= n;
+  }
+  return 1;
+}
+
+int writeFully(int fd, char *buffer, int size) {
+  int n;
+  while (size > 0) {
+    n = write(fd, buffer, size);
+    if (n <= 0) return 0;
+    buffer += n;
+    size -= n;
+  }
+  return 1;
+}
+
+int makeAddress(struct sockaddr_un *address, char *socketPath) {
+  if (strlen(socketPath) >= sizeof(address->sun_path))
+    return 0;
+  memset(address, 0, sizeof(struct sockaddr_un));
+  address->sun_family = AF_UNIX;
+  strcpy(address->sun_path, socketPath);
+  return 1;
+}
+
+/******************* Server ******************************/
+
+void applyFlags(char *flags) {
+  char *flag = strtok(flags, " ");
+  while (flag != NULL) {
+    if (strcmp(flag, "--layout") == 0)
+      printLayout = 1;
+    flag = strtok(NULL, " ");
+  }
+}
+
+// Compiles in the server process itself. An error unwinds to here instead
+// of exiting, and resetting the arena reclaims whatever the compile left.
+void compileRequest(int conn, char *source, int size) {
+  jmp_buf recovery;
+
+  fflush(stdout);
+  dup2(conn, STDOUT_FILENO);
+  errorRecovery = &recovery;
+  if (setjmp(recovery) == 0) {
+    if (compileBuffer(source, size) == IO_ERROR)
+      printf("Can\'t read input file!\n");
+  } else closeInputStream();
+  errorRecovery = NULL;
+  fflush(stdout);
+  dup2(serverStdout, STDOUT_FILENO);
+  resetArena();
+}
+
+// Request: "KPLC1 <flags length> <source length>\n", the flags, the source.
+// Reply: whatever the compiler prints, until the connection is closed.
+void serveRequest(int conn) {
+  char header[64];
+  char *flags, *source;
+  int flagsLength, sourceLength;
+  char *end;
+  int n;
+
+  // One peek finds the end of the header, instead of one read per byte
+  n = recv(conn, header, sizeof(header) - 1, MSG_PEEK);
+  end = (n > 0) ? memchr(header, '\n', n) : NULL;
+  if (end == NULL || !readFully(conn, header, end - header + 1))
+    return;
+  *end = '\0';
+  if (sscanf(header, "KPLC1 %d %d", &flagsLength, &sourceLength) != 2 ||
+      flagsLength < 0 || flagsLength > MAX_REQUEST_FLAGS ||
+      sourceLength < 0 || sourceLength > MAX_REQUEST_SOURCE)
+    return;
+
+  flags = (char*) malloc(flagsLength + 1);
+  source = (char*) malloc(sourceLength + 1);
+  if (readFully(conn, flags, flagsLength) && readFully(conn, source, sourceLength)) {
+    flags[flagsLength] = '\0';
+    printLayout = 0;
+    applyFlags(flags);
+    compileRequest(conn, source, sourceLength);
+  }
+  free(flags);
+  free(source);
+}
+
+void stopServer(int sig) {
+  unlink(serverSocketPath);
+  _exit(0);
+}
+
+// Removes a socket left by an earlier server, but never any other file
+void removeStaleSocket(char *socketPath) {
+  struct stat st;
+  if (lstat(socketPath, &st) == 0 && S_ISSOCK(st.st_mode))
+    unlink(socketPath);
+}
+
+// Requests are compiled one at a time in the server process, with no fork
+// per request. The predeclared environment is built once before the first
+// accept and kept; everything a request allocates comes from the arena,
+// which is reset, not returned to the system, once the reply is written.
+// A crash now takes the server down; clients then compile locally.
+int runServer(char *socketPath) {
+  struct sockaddr_un address;
+  int listenFd, conn;
+
+  if (!makeAddress(&address, socketPath)) {
+    fprintf(stderr, "kplc: socket path too long: %s\n", socketPath);
+    return -1;
+  }
+
+  listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd < 0) {
+    perror("kplc: socket");
+    return -1;
+  }
+  removeStaleSocket(socketPath);
+  if (bind(listenFd, (struct sockaddr*) &address, sizeof(address)) < 0 ||
+      listen(listenFd, SOMAXCONN) < 0) {
+    perror("kplc: bind");
+    close(listenFd);
+    return -1;
+  }
+
+  serverSocketPath = socketPath;
+  // a client that goes away must not take the server with it
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, stopServer);
+  signal(SIGTERM, stopServer);
+  serverStdout = dup(STDOUT_FILENO);
+  // a reply goes out in one write instead of one per stdio block
+  setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+  initSymTab();
+  keepSymTab = 1;
+  useArena = 1;
+  fprintf(stderr, "kplc: serving on %s\n", socketPath);
+
+  while (1) {
+    conn = accept(listenFd, NULL, NULL);
+    if (conn < 0) continue;
+    serveRequest(conn);
+    close(conn);
+  }
+  return 0;
+}
+
+/******************* Client ******************************/
+
+char *readSource(char *fileName, int *size) {
+  FILE *f = fopen(fileName, "rb");
+  char *source = NULL;
+  int capacity = 0, n;
+
+  if (f == NULL) return NULL;
+  *size = 0;
+  do {
+    if (*size == capacity) {
+      capacity = (capacity == 0) ? INPUT_BUFFER_SIZE : capacity * 2;
+      source = (char*) realloc(source, capacity);
+    }
+    n = fread(source + *size, 1, capacity - *size, f);
+    *size += n;
+  } while (n > 0 && *size <= MAX_REQUEST_SOURCE);
+  fclose(f);
+  return source;
+}
+
+int runClient(char *socketPath, char *fileName, char *flags) {
+  struct sockaddr_un address;
+  char header[64];
+  char buffer[INPUT_BUFFER_SIZE];
+  char *source;
+  int size, fd, n;
+
+  if (!makeAddress(&address, socketPath) || strlen(flags) > MAX_REQUEST_FLAGS)
+    return SERVER_UNAVAILABLE;
+
+  source = readSource(fileName, &size);
+  if (source == NULL)
+    return IO_ERROR;
+  if (size > MAX_REQUEST_SOURCE) {
+    free(source);
+    return SERVER_UNAVAILABLE;
+  }
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr*) &address, sizeof(address)) < 0) {
+    if (fd >= 0) close(fd);
+    free(source);
+    return SERVER_UNAVAILABLE;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  n = snprintf(header, sizeof(header), "KPLC1 %d %d\n", (int) strlen(flags), size);
+  if (!writeFully(fd, header, n) || !writeFully(fd, flags, strlen(flags)) ||
+      !writeFully(fd, source, size)) {
+    close(fd);
+    free(source);
+    return SERVER_UNAVAILABLE;
+  }
+  free(source);
+  shutdown(fd, SHUT_WR);
+
+  fflush(stdout);
+  while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+    writeFully(STDOUT_FILENO, buffer, n);
+  close(fd);
+  return IO_SUCCESS;
+}
@@ -0,0 +1,12 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#define SERVER_UNAVAILABLE -1
+
+#define MAX_REQUEST_SOURCE (64 * 1024 * 1024)
+#define MAX_REQUEST_FLAGS 1024
+
+int runServer(char *socketPath);
+int runClient(char *socketPath, char *fileName, char *flags);
+
+#endif
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stats.h"
+#include "report.h"
+
+#define TYPE_KEY_LEN 256
+
+int showStats = 0;
+CompilerStats stats;
+
+int chainLength = 0;
+
+/******************* String sets ******************************/
+
+// Kept off the ALLOC heap so that --mem-report is not disturbed
+struct StringSet_ {
+  char **slots;
+  int capacity;
+  int count;
+};
+
+typedef struct StringSet_ StringSet;
+
+StringSet spellings;
+StringSet typeKeys;
+
+unsigned hashSpelling(char *s) {
+  unsigned h = 2166136261u;
+  while (*s != '\0') {
+    h ^= (unsigned char) *s++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void growSet(StringSet *set);
+
+// Returns 1 if the string was not in the set yet
+int addString(StringSet *set, char *s) {
+  unsigned h;
+
+  if (2 * (set->count + 1) > set->capacity)
+    growSet(set);
+  h = hashSpelling(s) & (set->capacity - 1);
+  while (set->slots[h] != NULL) {
+    if (strcmp(set->slots[h], s) == 0) return 0;
+    h = (h + 1) & (set->capacity - 1);
+  }
+  set->slots[h] = strdup(s);
+  set->count ++;
+  return 1;
+}
+
+void growSet(StringSet *set) {
+  char **slots = set->slots;
+  int capacity = set->capacity;
+  int i;
+
+  set->capacity = (capacity == 0) ? 256 : capacity * 2;
+  set->slots = (char **) calloc(set->capacity, sizeof(char *));
+  set->count = 0;
+  for (i = 0; i < capacity; i++)
+    if (slots[i] != NULL) {
+      addString(set, slots[i]);
+      free(slots[i]);
+    }
+  free(slots);
+}
+
+/******************* Counting ******************************/
+
+void countToken(Token* token) {
+  if (token->tokenType < MAX_TOKEN_KINDS)
+    stats.tokens[token->tokenType] ++;
+  if (token->tokenType == TK_IDENT && addString(&spellings, token->string))
+    stats.spellings ++;
+}
+
+void countScope(Scope* scope) {
+  stats.scopes ++;
+  if (scope->level > stats.maxDepth)
+    stats.maxDepth = scope->level;
+}
+
+// Structural key of a type, e.g. A10(A5(I))
+void typeKey(Type* type, char *key, int size) {
+  int n;
+
+  switch (type->typeClass) {
+  case TP_INT:
+    snprintf(key, size, "I");
+    break;
+  case TP_CHAR:
+    snprintf(key, size, "C");
+    break;
+  case TP_BYTE:
+    snprintf(key, size, "B");
+    break;
+  case TP_ARRAY:
+    n = snprintf(key, size, "A%d(", type->arraySize);
+    if (n < size - 1) {
+      typeKey(type->elementType, key + n, size - n);
+      n = strlen(key);
+      if (n < size - 1) strcat(key, ")");
+    }
+    break;
+  }
+}
+
+void countType(Type* type) {
+  char key[TYPE_KEY_LEN];
+
+  stats.types ++;
+  typeKey(type, key, TYPE_KEY_LEN);
+  if (addString(&typeKeys, key))
+    stats.uniqueTypes ++;
+}
+
+// An expression chain is the run of operands joined by + - * / at one
+// level; arguments and indexes start chains of their own.
+int beginChain(void) {
+  int outerChain = chainLength;
+  chainLength = 1;
+  return outerChain;
+}
+
+void extendChain(void) {
+  chainLength ++;
+}
+
+void endChain(int outerChain) {
+  if (chainLength > stats.longestChain)
+    stats.longestChain = chainLength;
+  chainLength = outerChain;
+}
+
+/******************* Output ******************************/
+
+char *objectKindNames[OBJECT_KINDS] = {
+  "constant", "variable", "type", "function", "procedure", "parameter", "program"
+};
+
+double average(long long sum, long long count) {
+  return (count > 0) ? (double) sum / count : 0.0;
+}
+
+void printStats(void) {
+  FILE *out = stderr;
+  int i, first = 1;
+
+  if (jsonReport) {
+    fprintf(out, "{\"stats\": {\"tokens\": {");
+    for (i = 0; i < MAX_TOKEN_KINDS; i++)
+      if (stats.tokens[i] > 0) {
+	fprintf(out, "%s\"%s\": %lld", first ? "" : ", ", tokenToString(i), stats.tokens[i]);
+	first = 0;
+      }
+    fprintf(out, "}, \"identifiers\": %lld, \"distinct_spellings\": %lld, \"scopes\": %lld, "
+	    "\"max_depth\": %d, \"objects\": {",
+	    stats.tokens[TK_IDENT], stats.spellings, stats.scopes, stats.maxDepth);
+    for (i = 0; i < OBJECT_KINDS; i++)
+      fprintf(out, "%s\"%s\": %lld", (i > 0) ? ", " : "", objectKindNames[i], stats.objects[i]);
+    fprintf(out, "}, \"lookups\": %lld, \"name_searches\": %lld, \"name_probes\": %lld, \"find_calls\": %lld, "
+	    "\"find_comparisons\": %lld, \"types\": %lld, \"unique_types\": %lld, "
+	    "\"longest_chain\": %d}}\n",
+	    stats.lookups, stats.nameSearches, stats.nameProbes, stats.findCalls,
+	    stats.findComparisons, stats.types, stats.uniqueTypes, stats.longestChain);
+    return;
+  }
+
+  fprintf(out, "Statistics:\n");
+  fprintf(out, "  tokens by kind:\n");
+  for (i = 0; i < MAX_TOKEN_KINDS; i++)
+    if (stats.tokens[i] > 0)
+      fprintf(out, "    %-22s %10lld\n", tokenToString(i), stats.tokens[i]);
+  fprintf(out, "  %-24s %10lld\n", "identifiers", stats.tokens[TK_IDENT]);
+  fprintf(out, "  %-24s %10lld\n", "distinct spellings", stats.spellings);
+  fprintf(out, "  %-24s %10lld\n", "scopes", stats.scopes);
+  fprintf(out, "  %-24s %10d\n", "maximum nesting depth", stats.maxDepth);
+  fprintf(out, "  objects by kind:\n");
+  for (i = 0; i < OBJECT_KINDS; i++)
+    fprintf(out, "    %-22s %10lld\n", objectKindNames[i], stats.objects[i]);
+  fprintf(out, "  %-24s %10lld\n", "lookupObject calls", stats.lookups);
+  fprintf(out, "  %-24s %10lld (%lld probes, %.2f per search)\n", "name table searches",
+	  stats.nameSearches, stats.nameProbes, average(stats.nameProbes, stats.nameSearches));
+  fprintf(out, "  %-24s %10lld (%lld comparisons, %.2f per call)\n", "findObject calls",
+	  stats.findCalls, stats.findComparisons, average(stats.findComparisons, stats.findCalls));
+  fprintf(out, "  %-24s %10lld (%lld unique)\n", "types created", stats.types, stats.uniqueTypes);
+  fprintf(out, "  %-24s %10d operands\n", "longest expression chain", stats.longestChain);
+}
+
+// Returns 0 when the counters were compiled out
+int startStats(void) {
+#ifdef KPL_STATS
+  atexit(printStats);
+  return 1;
+#else
+  fprintf(stderr, "kplc: statistics are not compiled in, rebuild with make STATS=1\n");
+  return 0;
+#endif
+}
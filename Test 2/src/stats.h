@@ -0,0 +1,47 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "token.h"
+#include "symtab.h"
+
+/* Counters are only compiled in with -DKPL_STATS (make STATS=1); in a
+   normal build STAT() expands to nothing */
+#ifdef KPL_STATS
+#define STAT(statement) statement
+#else
+#define STAT(statement)
+#endif
+
+#define MAX_TOKEN_KINDS 64
+#define OBJECT_KINDS (OBJ_PROGRAM + 1)
+
+struct CompilerStats_ {
+  long long tokens[MAX_TOKEN_KINDS];
+  long long spellings;
+  long long scopes;
+  int maxDepth;
+  long long objects[OBJECT_KINDS];
+  long long lookups;
+  long long nameSearches;
+  long long nameProbes;
+  long long findCalls;
+  long long findComparisons;
+  long long types;
+  long long uniqueTypes;
+  int longestChain;
+};
+
+typedef struct CompilerStats_ CompilerStats;
+
+extern int showStats;
+extern CompilerStats stats;
+
+void countToken(Token* token);
+void countScope(Scope* scope);
+void countType(Type* type);
+int beginChain(void);
+void extendChain(void);
+void endChain(int outerChain);
+int startStats(void);
+
+#endif
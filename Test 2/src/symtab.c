@@ -9,6 +9,8 @@
 #include <string.h>
 #include "symtab.h"
 #include "error.h"
+#include "alloc.h"
+#include "stats.h"
 
 void freeObject(Object* obj);
 void freeScope(Scope* scope);
@@ -16,38 +18,51 @@ void freeObjectList(ObjectNode *objList);
 void freeReferenceList(ObjectNode *objList);
 
 SymTab* symtab;
+// Set by a compile server to keep the predeclared environment between programs
+int keepSymTab = 0;
 Type* intType;
 Type* charType;
 
 /******************* Type utilities ******************************/
 
 Type* makeIntType(void) {
-  Type* type = (Type*) malloc(sizeof(Type));
+  Type* type = (Type*) ALLOC(sizeof(Type));
   type->typeClass = TP_INT;
+  STAT(countType(type));
   return type;
 }
 
 Type* makeCharType(void) {
-  Type* type = (Type*) malloc(sizeof(Type));
+  Type* type = (Type*) ALLOC(sizeof(Type));
   type->typeClass = TP_CHAR;
+  STAT(countType(type));
+  return type;
+}
+
+Type* makeByteType(void) {
+  Type* type = (Type*) ALLOC(sizeof(Type));
+  type->typeClass = TP_BYTE;
+  STAT(countType(type));
   return type;
 }
 
 Type* makeArrayType(int arraySize, Type* elementType) {
-  Type* type = (Type*) malloc(sizeof(Type));
+  Type* type = (Type*) ALLOC(sizeof(Type));
   type->typeClass = TP_ARRAY;
   type->arraySize = arraySize;
   type->elementType = elementType;
+  STAT(countType(type));
   return type;
 }
 
 Type* duplicateType(Type* type) {
-  Type* resultType = (Type*) malloc(sizeof(Type));
+  Type* resultType = (Type*) ALLOC(sizeof(Type));
   resultType->typeClass = type->typeClass;
   if (type->typeClass == TP_ARRAY) {
     resultType->arraySize = type->arraySize;
     resultType->elementType = duplicateType(type->elementType);
   }
+  STAT(countType(resultType));
   return resultType;
 }
 
@@ -65,33 +80,62 @@ void freeType(Type* type) {
   switch (type->typeClass) {
   case TP_INT:
   case TP_CHAR:
-    free(type);
+  case TP_BYTE:
+    FREE(type);
     break;
   case TP_ARRAY:
     freeType(type->elementType);
-    freeType(type);
+    FREE(type);
     break;
   }
 }
 
+int sizeOfType(Type* type) {
+  switch (type->typeClass) {
+  case TP_INT:
+    return INT_SIZE;
+  case TP_CHAR:
+    return CHAR_SIZE;
+  case TP_BYTE:
+    return BYTE_SIZE;
+  case TP_ARRAY:
+    return type->arraySize * sizeOfType(type->elementType);
+  }
+  return 0;
+}
+
+int alignOfType(Type* type) {
+  switch (type->typeClass) {
+  case TP_INT:
+    return INT_SIZE;
+  case TP_CHAR:
+    return CHAR_SIZE;
+  case TP_BYTE:
+    return BYTE_SIZE;
+  case TP_ARRAY:
+    return alignOfType(type->elementType);
+  }
+  return 1;
+}
+
 /******************* Constant utility ******************************/
 
 ConstantValue* makeIntConstant(int i) {
-  ConstantValue* value = (ConstantValue*) malloc(sizeof(ConstantValue));
+  ConstantValue* value = (ConstantValue*) ALLOC(sizeof(ConstantValue));
   value->type = TP_INT;
   value->intValue = i;
   return value;
 }
 
 ConstantValue* makeCharConstant(char ch) {
-  ConstantValue* value = (ConstantValue*) malloc(sizeof(ConstantValue));
+  ConstantValue* value = (ConstantValue*) ALLOC(sizeof(ConstantValue));
   value->type = TP_CHAR;
   value->charValue = ch;
   return value;
 }
 
 ConstantValue* duplicateConstantValue(ConstantValue* v) {
-  ConstantValue* value = (ConstantValue*) malloc(sizeof(ConstantValue));
+  ConstantValue* value = (ConstantValue*) ALLOC(sizeof(ConstantValue));
   value->type = v->type;
   if (v->type == TP_INT) 
     value->intValue = v->intValue;
@@ -103,118 +147,131 @@ ConstantValue* duplicateConstantValue(ConstantValue* v) {
 /******************* Object utilities ******************************/
 
 Scope* createScope(Object* owner, Scope* outer) {
-  Scope* scope = (Scope*) malloc(sizeof(Scope));
+  Scope* scope = (Scope*) ALLOC(sizeof(Scope));
   scope->objList = NULL;
+  scope->lastObject = NULL;
   scope->owner = owner;
   scope->outer = outer;
+  scope->level = (outer == NULL) ? 0 : outer->level + 1;
+  scope->frameSize = RESERVED_SIZE;
+  STAT(countScope(scope));
   return scope;
 }
 
 Object* createProgramObject(char *programName) {
-  Object* program = (Object*) malloc(sizeof(Object));
+  Object* program = (Object*) ALLOC(sizeof(Object));
   strcpy(program->name, programName);
   program->kind = OBJ_PROGRAM;
-  program->progAttrs = (ProgramAttributes*) malloc(sizeof(ProgramAttributes));
+  program->progAttrs = (ProgramAttributes*) ALLOC(sizeof(ProgramAttributes));
   program->progAttrs->scope = createScope(program,NULL);
   symtab->program = program;
+  STAT(stats.objects[OBJ_PROGRAM] ++);
 
   return program;
 }
 
 Object* createConstantObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
+  Object* obj = (Object*) ALLOC(sizeof(Object));
   strcpy(obj->name, name);
   obj->kind = OBJ_CONSTANT;
-  obj->constAttrs = (ConstantAttributes*) malloc(sizeof(ConstantAttributes));
+  obj->constAttrs = (ConstantAttributes*) ALLOC(sizeof(ConstantAttributes));
+  STAT(stats.objects[OBJ_CONSTANT] ++);
   return obj;
 }
 
 Object* createTypeObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
+  Object* obj = (Object*) ALLOC(sizeof(Object));
   strcpy(obj->name, name);
   obj->kind = OBJ_TYPE;
-  obj->typeAttrs = (TypeAttributes*) malloc(sizeof(TypeAttributes));
+  obj->typeAttrs = (TypeAttributes*) ALLOC(sizeof(TypeAttributes));
+  STAT(stats.objects[OBJ_TYPE] ++);
   return obj;
 }
 
 Object* createVariableObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
+  Object* obj = (Object*) ALLOC(sizeof(Object));
   strcpy(obj->name, name);
   obj->kind = OBJ_VARIABLE;
-  obj->varAttrs = (VariableAttributes*) malloc(sizeof(VariableAttributes));
+  obj->varAttrs = (VariableAttributes*) ALLOC(sizeof(VariableAttributes));
   obj->varAttrs->scope = symtab->currentScope;
+  obj->varAttrs->localOffset = 0;
+  STAT(stats.objects[OBJ_VARIABLE] ++);
   return obj;
 }
 
 Object* createFunctionObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
+  Object* obj = (Object*) ALLOC(sizeof(Object));
   strcpy(obj->name, name);
   obj->kind = OBJ_FUNCTION;
-  obj->funcAttrs = (FunctionAttributes*) malloc(sizeof(FunctionAttributes));
+  obj->funcAttrs = (FunctionAttributes*) ALLOC(sizeof(FunctionAttributes));
   obj->funcAttrs->paramList = NULL;
   obj->funcAttrs->scope = createScope(obj, symtab->currentScope);
+  STAT(stats.objects[OBJ_FUNCTION] ++);
   return obj;
 }
 
 Object* createProcedureObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
+  Object* obj = (Object*) ALLOC(sizeof(Object));
   strcpy(obj->name, name);
   obj->kind = OBJ_PROCEDURE;
-  obj->procAttrs = (ProcedureAttributes*) malloc(sizeof(ProcedureAttributes));
+  obj->procAttrs = (ProcedureAttributes*) ALLOC(sizeof(ProcedureAttributes));
   obj->procAttrs->paramList = NULL;
   obj->procAttrs->scope = createScope(obj, symtab->currentScope);
+  STAT(stats.objects[OBJ_PROCEDURE] ++);
   return obj;
 }
 
 Object* createParameterObject(char *name, enum ParamKind kind, Object* owner) {
-  Object* obj = (Object*) malloc(sizeof(Object));
+  Object* obj = (Object*) ALLOC(sizeof(Object));
   strcpy(obj->name, name);
   obj->kind = OBJ_PARAMETER;
-  obj->paramAttrs = (ParameterAttributes*) malloc(sizeof(ParameterAttributes));
+  obj->paramAttrs = (ParameterAttributes*) ALLOC(sizeof(ParameterAttributes));
   obj->paramAttrs->kind = kind;
   obj->paramAttrs->function = owner;
+  obj->paramAttrs->localOffset = 0;
+  STAT(stats.objects[OBJ_PARAMETER] ++);
   return obj;
 }
 
 void freeObject(Object* obj) {
   switch (obj->kind) {
   case OBJ_CONSTANT:
-    free(obj->constAttrs->value);
-    free(obj->constAttrs);
+    FREE(obj->constAttrs->value);
+    FREE(obj->constAttrs);
     break;
   case OBJ_TYPE:
-    free(obj->typeAttrs->actualType);
-    free(obj->typeAttrs);
+    freeType(obj->typeAttrs->actualType);
+    FREE(obj->typeAttrs);
     break;
   case OBJ_VARIABLE:
-    free(obj->varAttrs->type);
-    free(obj->varAttrs);
+    freeType(obj->varAttrs->type);
+    FREE(obj->varAttrs);
     break;
   case OBJ_FUNCTION:
     freeReferenceList(obj->funcAttrs->paramList);
     freeType(obj->funcAttrs->returnType);
     freeScope(obj->funcAttrs->scope);
-    free(obj->funcAttrs);
+    FREE(obj->funcAttrs);
     break;
   case OBJ_PROCEDURE:
     freeReferenceList(obj->procAttrs->paramList);
     freeScope(obj->procAttrs->scope);
-    free(obj->procAttrs);
+    FREE(obj->procAttrs);
     break;
   case OBJ_PROGRAM:
     freeScope(obj->progAttrs->scope);
-    free(obj->progAttrs);
+    FREE(obj->progAttrs);
     break;
   case OBJ_PARAMETER:
     freeType(obj->paramAttrs->type);
-    free(obj->paramAttrs);
+    FREE(obj->paramAttrs);
   }
-  free(obj);
+  FREE(obj);
 }
 
 void freeScope(Scope* scope) {
   freeObjectList(scope->objList);
-  free(scope);
+  FREE(scope);
 }
 
 void freeObjectList(ObjectNode *objList) {
@@ -224,7 +281,7 @@ void freeObjectList(ObjectNode *objList) {
     ObjectNode* node = list;
     list = list->next;
     freeObject(node->object);
-    free(node);
+    FREE(node);
   }
 }
 
@@ -234,12 +291,12 @@ void freeReferenceList(ObjectNode *objList) {
   while (list != NULL) {
     ObjectNode* node = list;
     list = list->next;
-    free(node);
+    FREE(node);
   }
 }
 
 void addObject(ObjectNode **objList, Object* obj) {
-  ObjectNode* node = (ObjectNode*) malloc(sizeof(ObjectNode));
+  ObjectNode* node = (ObjectNode*) ALLOC(sizeof(ObjectNode));
   node->object = obj;
   node->next = NULL;
   if ((*objList) == NULL) 
@@ -252,8 +309,20 @@ void addObject(ObjectNode **objList, Object* obj) {
   }
 }
 
+void addScopeObject(Scope* scope, Object* obj) {
+  ObjectNode* node = (ObjectNode*) ALLOC(sizeof(ObjectNode));
+  node->object = obj;
+  node->next = NULL;
+  if (scope->lastObject == NULL)
+    scope->objList = node;
+  else scope->lastObject->next = node;
+  scope->lastObject = node;
+}
+
 Object* findObject(ObjectNode *objList, char *name) {
+  STAT(stats.findCalls ++);
   while (objList != NULL) {
+    STAT(stats.findComparisons ++);
     if (strcmp(objList->object->name, name) == 0) 
       return objList->object;
     else objList = objList->next;
@@ -261,13 +330,148 @@ Object* findObject(ObjectNode *objList, char *name) {
   return NULL;
 }
 
+/******************* Storage allocation ******************************/
+
+int alignUp(int n, int align) {
+  return ((n + align - 1) / align) * align;
+}
+
+int allocateStorage(Scope* scope, int size, int align) {
+  int offset = alignUp(scope->frameSize, align);
+  scope->frameSize = offset + size;
+  return offset;
+}
+
+void allocateParameter(Scope* scope, Object* param) {
+  if (param->paramAttrs->kind == PARAM_REFERENCE)
+    param->paramAttrs->localOffset = allocateStorage(scope, REF_SIZE, REF_SIZE);
+  else
+    param->paramAttrs->localOffset = allocateStorage(scope, sizeOfType(param->paramAttrs->type), 
+						     alignOfType(param->paramAttrs->type));
+}
+
+/******************* Name bindings ******************************/
+
+unsigned hashName(char *name) {
+  unsigned h = 2166136261u;
+  while (*name != '\0') {
+    h ^= (unsigned char) *name++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void initNames(int buckets) {
+  symtab->nameBuckets = buckets;
+  symtab->nameCount = 0;
+  symtab->names = (NameEntry**) ALLOC(buckets * sizeof(NameEntry*));
+  memset(symtab->names, 0, buckets * sizeof(NameEntry*));
+}
+
+void growNames(void) {
+  NameEntry** names = symtab->names;
+  int buckets = symtab->nameBuckets;
+  NameEntry* entry;
+  unsigned h;
+  int i;
+
+  symtab->nameBuckets = buckets * 2;
+  symtab->names = (NameEntry**) ALLOC(symtab->nameBuckets * sizeof(NameEntry*));
+  memset(symtab->names, 0, symtab->nameBuckets * sizeof(NameEntry*));
+  for (i = 0; i < buckets; i++)
+    while ((entry = names[i]) != NULL) {
+      names[i] = entry->next;
+      h = hashName(entry->name) & (symtab->nameBuckets - 1);
+      entry->next = symtab->names[h];
+      symtab->names[h] = entry;
+    }
+  FREE(names);
+}
+
+NameEntry* findNameEntry(char *name) {
+  NameEntry* entry = symtab->names[hashName(name) & (symtab->nameBuckets - 1)];
+
+  STAT(stats.nameSearches ++);
+  while (entry != NULL) {
+    STAT(stats.nameProbes ++);
+    if (strcmp(entry->name, name) == 0)
+      return entry;
+    entry = entry->next;
+  }
+  return NULL;
+}
+
+// The innermost visible declaration of name, or NULL
+Binding* findBinding(char *name) {
+  NameEntry* entry = findNameEntry(name);
+  return (entry != NULL) ? entry->binding : NULL;
+}
+
+void bindObject(Scope* scope, Object* obj) {
+  NameEntry* entry = findNameEntry(obj->name);
+  Binding* binding;
+  unsigned h;
+
+  if (entry == NULL) {
+    if (symtab->nameCount >= symtab->nameBuckets)
+      growNames();
+    entry = (NameEntry*) ALLOC(sizeof(NameEntry));
+    strcpy(entry->name, obj->name);
+    entry->binding = NULL;
+    h = hashName(entry->name) & (symtab->nameBuckets - 1);
+    entry->next = symtab->names[h];
+    symtab->names[h] = entry;
+    symtab->nameCount ++;
+  }
+
+  binding = (Binding*) ALLOC(sizeof(Binding));
+  binding->object = obj;
+  binding->scope = scope;
+  binding->shadowed = entry->binding;
+  entry->binding = binding;
+}
+
+// Scopes are closed innermost first, so each binding of the scope is
+// still on top of its name
+void unbindScope(Scope* scope) {
+  ObjectNode* node;
+  NameEntry* entry;
+  Binding* binding;
+
+  for (node = scope->objList; node != NULL; node = node->next) {
+    entry = findNameEntry(node->object->name);
+    binding = entry->binding;
+    entry->binding = binding->shadowed;
+    FREE(binding);
+  }
+}
+
+void freeNames(void) {
+  NameEntry* entry;
+  Binding* binding;
+  int i;
+
+  for (i = 0; i < symtab->nameBuckets; i++)
+    while ((entry = symtab->names[i]) != NULL) {
+      symtab->names[i] = entry->next;
+      while ((binding = entry->binding) != NULL) {
+	entry->binding = binding->shadowed;
+	FREE(binding);
+      }
+      FREE(entry);
+    }
+  FREE(symtab->names);
+}
+
 /******************* others ******************************/
 
 void initSymTab(void) {
   Object* obj;
   Object* param;
 
-  symtab = (SymTab*) malloc(sizeof(SymTab));
+  symtab = (SymTab*) ALLOC(sizeof(SymTab));
+  symtab->program = NULL;
+  symtab->currentScope = NULL;
   symtab->globalObjectList = NULL;
   
   obj = createFunctionObject("READC");
@@ -281,13 +485,17 @@ void initSymTab(void) {
   obj = createProcedureObject("WRITEI");
   param = createParameterObject("i", PARAM_VALUE, obj);
   param->paramAttrs->type = makeIntType();
+  allocateParameter(obj->procAttrs->scope, param);
   addObject(&(obj->procAttrs->paramList),param);
+  addScopeObject(obj->procAttrs->scope, param);
   addObject(&(symtab->globalObjectList), obj);
 
   obj = createProcedureObject("WRITEC");
   param = createParameterObject("ch", PARAM_VALUE, obj);
   param->paramAttrs->type = makeCharType();
+  allocateParameter(obj->procAttrs->scope, param);
   addObject(&(obj->procAttrs->paramList),param);
+  addScopeObject(obj->procAttrs->scope, param);
   addObject(&(symtab->globalObjectList), obj);
 
   obj = createProcedureObject("WRITELN");
@@ -297,10 +505,28 @@ void initSymTab(void) {
   charType = makeCharType();
 }
 
+// A program is compiled between beginProgram and endProgram. The
+// predeclared environment outlives it, so a compile server can keep one
+// environment for every request.
+void beginProgram(void) {
+  symtab->program = NULL;
+  symtab->currentScope = NULL;
+  initNames(INITIAL_NAME_BUCKETS);
+}
+
+void endProgram(void) {
+  // an arena takes everything back at once when it is reset
+  if (!useArena) {
+    freeObject(symtab->program);
+    freeNames();
+  }
+  symtab->program = NULL;
+}
+
 void cleanSymTab(void) {
-  freeObject(symtab->program);
   freeObjectList(symtab->globalObjectList);
-  free(symtab);
+  FREE(symtab);
+  symtab = NULL;
   freeType(intType);
   freeType(charType);
 }
@@ -310,10 +536,28 @@ void enterBlock(Scope* scope) {
 }
 
 void exitBlock(void) {
-  symtab->currentScope = symtab->currentScope->outer;
+  Scope* scope = symtab->currentScope;
+  scope->frameSize = alignUp(scope->frameSize, WORD_SIZE);
+  unbindScope(scope);
+  symtab->currentScope = scope->outer;
 }
 
 void declareObject(Object* obj) {
+  Scope* scope = symtab->currentScope;
+
+  switch (obj->kind) {
+  case OBJ_VARIABLE:
+    obj->varAttrs->scope = scope;
+    obj->varAttrs->localOffset = allocateStorage(scope, sizeOfType(obj->varAttrs->type), 
+						 alignOfType(obj->varAttrs->type));
+    break;
+  case OBJ_PARAMETER:
+    allocateParameter(scope, obj);
+    break;
+  default:
+    break;
+  }
+
   if (obj->kind == OBJ_PARAMETER) {
     Object* owner = symtab->currentScope->owner;
     switch (owner->kind) {
@@ -328,7 +572,8 @@ void declareObject(Object* obj) {
     }
   }
  
-  addObject(&(symtab->currentScope->objList), obj);
+  addScopeObject(scope, obj);
+  bindObject(scope, obj);
 }
 
 
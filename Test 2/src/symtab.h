@@ -9,10 +9,23 @@
 
 #include "token.h"
 
+/* Storage sizes are in bytes; a frame starts with RESERVED_SIZE bytes
+   holding the return value, dynamic link, return address and static link */
+#define WORD_SIZE 4
+#define INT_SIZE 4
+#define CHAR_SIZE 1
+#define BYTE_SIZE 1
+#define REF_SIZE WORD_SIZE
+#define RESERVED_SIZE (4 * WORD_SIZE)
+
+/* A BYTE holds 0..255 in one byte of storage, also as an array element.
+   It widens to INTEGER in expressions; storing an INTEGER into a BYTE
+   keeps the low 8 bits. */
 enum TypeClass {
   TP_INT,
   TP_CHAR,
-  TP_ARRAY
+  TP_ARRAY,
+  TP_BYTE
 };
 
 enum ObjectKind {
@@ -61,6 +74,7 @@ struct ConstantAttributes_ {
 struct VariableAttributes_ {
   Type *type;
   struct Scope_ *scope;
+  int localOffset;
 };
 
 struct TypeAttributes_ {
@@ -86,6 +100,7 @@ struct ParameterAttributes_ {
   enum ParamKind kind;
   Type* type;
   struct Object_ *function;
+  int localOffset;
 };
 
 typedef struct ConstantAttributes_ ConstantAttributes;
@@ -121,26 +136,56 @@ typedef struct ObjectNode_ ObjectNode;
 
 struct Scope_ {
   ObjectNode *objList;
+  ObjectNode *lastObject;
   Object *owner;
   struct Scope_ *outer;
+  int level;
+  int frameSize;
 };
 
 typedef struct Scope_ Scope;
 
+/* Every name declared in an open scope is bound in a hash table; a
+   declaration in an inner scope shadows the outer binding until its
+   scope is exited. Lookups therefore do not walk the scope chain. */
+#define INITIAL_NAME_BUCKETS 256
+
+struct Binding_ {
+  Object *object;
+  Scope *scope;
+  struct Binding_ *shadowed;
+};
+
+typedef struct Binding_ Binding;
+
+struct NameEntry_ {
+  char name[MAX_IDENT_LEN + 1];
+  Binding *binding;
+  struct NameEntry_ *next;
+};
+
+typedef struct NameEntry_ NameEntry;
+
 struct SymTab_ {
   Object* program;
   Scope* currentScope;
   ObjectNode *globalObjectList;
+  NameEntry **names;
+  int nameBuckets;
+  int nameCount;
 };
 
 typedef struct SymTab_ SymTab;
 
 Type* makeIntType(void);
 Type* makeCharType(void);
+Type* makeByteType(void);
 Type* makeArrayType(int arraySize, Type* elementType);
 Type* duplicateType(Type* type);
 int compareType(Type* type1, Type* type2);
 void freeType(Type* type);
+int sizeOfType(Type* type);
+int alignOfType(Type* type);
 
 ConstantValue* makeIntConstant(int i);
 ConstantValue* makeCharConstant(char ch);
@@ -156,10 +201,16 @@ Object* createFunctionObject(char *name);
 Object* createProcedureObject(char *name);
 Object* createParameterObject(char *name, enum ParamKind kind, Object* owner);
 
+void addObject(ObjectNode **objList, Object* obj);
 Object* findObject(ObjectNode *objList, char *name);
+Binding* findBinding(char *name);
+
+extern int keepSymTab;
 
 void initSymTab(void);
 void cleanSymTab(void);
+void beginProgram(void);
+void endProgram(void);
 void enterBlock(Scope* scope);
 void exitBlock(void);
 void declareObject(Object* obj);
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include "token.h"
+#include "alloc.h"
 
 struct {
   char string[MAX_IDENT_LEN + 1];
@@ -33,6 +34,7 @@ struct {
   {"FOR", KW_FOR},
   {"TO", KW_TO},
   {"SUM", KW_SUM},
+  {"BYTE", KW_BYTE},
 };
 
 int keywordEq(char *kw, char *string) {
@@ -52,7 +54,7 @@ TokenType checkKeyword(char *string) {
 }
 
 Token* makeToken(TokenType tokenType, int lineNo, int colNo) {
-  Token *token = (Token*)malloc(sizeof(Token));
+  Token *token = (Token*) ALLOC(sizeof(Token));
   token->tokenType = tokenType;
   token->lineNo = lineNo;
   token->colNo = colNo;
@@ -87,6 +89,8 @@ char *tokenToString(TokenType tokenType) {
   case KW_DO: return "keyword DO";
   case KW_FOR: return "keyword FOR";
   case KW_TO: return "keyword TO";
+  case KW_SUM: return "keyword SUM";
+  case KW_BYTE: return "keyword BYTE";
 
   case SB_SEMICOLON: return "\';\'";
   case SB_COLON: return "\':\'";
@@ -107,6 +111,7 @@ char *tokenToString(TokenType tokenType) {
   case SB_RPAR: return "\')\'";
   case SB_LSEL: return "\'(.\'";
   case SB_RSEL: return "\'.)\'";
+  case SB_POWER: return "\'**\'";
   default: return "";
   }
 }
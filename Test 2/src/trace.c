@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "trace.h"
+
+/* Events are recorded in a buffer owned by the thread that produced them.
+   Buffers are linked into a global list with an atomic push, and the whole
+   list is written in Chrome trace-event format when the process exits.
+   Open spans form a chain through their parent indexes, so nesting is
+   limited only by the size of the buffer. */
+struct TraceBuffer_ {
+  TraceEvent *events;
+  int count;
+  int capacity;
+  int current;
+  long tid;
+  struct TraceBuffer_ *next;
+};
+
+typedef struct TraceBuffer_ TraceBuffer;
+
+char *traceFileName = NULL;
+
+TraceBuffer *traceBuffers = NULL;
+__thread TraceBuffer *threadBuffer = NULL;
+long long traceStart;
+
+long long traceClock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+TraceBuffer *getThreadBuffer(void) {
+  TraceBuffer *buffer = threadBuffer;
+
+  if (buffer != NULL) return buffer;
+  buffer = (TraceBuffer*) calloc(1, sizeof(TraceBuffer));
+  buffer->tid = syscall(SYS_gettid);
+  buffer->current = -1;
+  buffer->next = __atomic_load_n(&traceBuffers, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&traceBuffers, &buffer->next, buffer, 0,
+				      __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    ;
+  threadBuffer = buffer;
+  return buffer;
+}
+
+void beginSpan(const char *name, const char *category, int lineNo) {
+  TraceBuffer *buffer = getThreadBuffer();
+  TraceEvent *event;
+
+  if (buffer->count == buffer->capacity) {
+    buffer->capacity = (buffer->capacity == 0) ? 256 : buffer->capacity * 2;
+    buffer->events = (TraceEvent*) realloc(buffer->events, buffer->capacity * sizeof(TraceEvent));
+  }
+  event = &buffer->events[buffer->count];
+  strncpy(event->name, name, MAX_IDENT_LEN);
+  event->name[MAX_IDENT_LEN] = '\0';
+  event->category = category;
+  event->lineNo = lineNo;
+  event->duration = -1;
+  event->parent = buffer->current;
+  event->start = traceClock();
+
+  buffer->current = buffer->count;
+  buffer->count ++;
+}
+
+void endSpan(void) {
+  TraceBuffer *buffer = threadBuffer;
+  TraceEvent *event;
+
+  if (buffer == NULL || buffer->current < 0) return;
+  event = &buffer->events[buffer->current];
+  event->duration = traceClock() - event->start;
+  buffer->current = event->parent;
+}
+
+void writeTrace(void) {
+  TraceBuffer *buffer;
+  TraceEvent *event;
+  long long now = traceClock();
+  int first = 1;
+  int i;
+  FILE *f = fopen(traceFileName, "w");
+
+  if (f == NULL) {
+    fprintf(stderr, "kplc: cannot write trace file %s\n", traceFileName);
+    return;
+  }
+
+  fprintf(f, "{\"traceEvents\": [\n");
+  for (buffer = __atomic_load_n(&traceBuffers, __ATOMIC_ACQUIRE); buffer != NULL; buffer = buffer->next)
+    for (i = 0; i < buffer->count; i++) {
+      event = &buffer->events[i];
+      // spans still open here were cut short by an error
+      if (event->duration < 0)
+	event->duration = now - event->start;
+      fprintf(f, "%s  {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+	      "\"pid\": %d, \"tid\": %ld, \"args\": {\"line\": %d}}",
+	      first ? "" : ",\n", event->name, event->category,
+	      (event->start - traceStart) / 1e3, event->duration / 1e3,
+	      (int) getpid(), buffer->tid, event->lineNo);
+      first = 0;
+    }
+  fprintf(f, "\n], \"displayTimeUnit\": \"ns\"}\n");
+  fclose(f);
+}
+
+void startTrace(void) {
+  if (traceFileName == NULL) return;
+  traceStart = traceClock();
+  atexit(writeTrace);
+}
@@ -0,0 +1,30 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "token.h"
+
+#define TRACE_BEGIN(name, category, lineNo) do { \
+    if (traceFileName != NULL) beginSpan(name, category, lineNo); \
+  } while (0)
+#define TRACE_END() do { \
+    if (traceFileName != NULL) endSpan(); \
+  } while (0)
+
+struct TraceEvent_ {
+  char name[MAX_IDENT_LEN + 1];
+  const char *category;
+  int lineNo;
+  int parent;                 // index of the enclosing span, -1 at the top
+  long long start;
+  long long duration;
+};
+
+typedef struct TraceEvent_ TraceEvent;
+
+extern char *traceFileName;
+
+void startTrace(void);
+void beginSpan(const char *name, const char *category, int lineNo);
+void endSpan(void);
+
+#endif